@@ -46,6 +46,25 @@ static auto malloc_body = [&](lng numValues, double& time)
     time = duration_cast<duration<double, milli >> (toc - tic).count();
 };
 
+/**
+ * FRC's pool allocator on its own, at the size of an FRC allocation of Type.
+ */
+static auto pool_body = [&](lng numValues, double& time)
+{
+    static constexpr auto size = sizeof(frc::detail::ObjectHeader) + sizeof(Type);
+    high_resolution_clock::time_point tic, toc;
+
+    tic = high_resolution_clock::now();
+    std::unique_ptr < void*[] > ptrs(new void*[numValues]);
+    for(lng i = 0; i < numValues; ++i)
+        ptrs[i] = frc::detail::PoolAllocator::allocate(size);
+    toc = high_resolution_clock::now();
+
+    for(lng i = 0; i < numValues; ++i)
+        frc::detail::PoolAllocator::deallocate(ptrs[i], size);
+    time = duration_cast<duration<double, milli >> (toc - tic).count();
+};
+
 static auto std_body = [&](lng numValues, double& time)
 {
     high_resolution_clock::time_point tic, toc;
@@ -115,7 +134,7 @@ static auto frc_s_mp_body = [&](lng numValues, double& time)
 static auto frc_p_m_body = [&](lng numValues, double& time)
 {
     time = 0.;
-    static constexpr lng pinSetSize = terrain::frc::detail::FRCConstants::pinSetSize;
+    static constexpr lng pinSetSize = terrain::frc::detail::FRCConstants::pinBlockSize;
     high_resolution_clock::time_point tic, toc;
 
     for(lng counter = pinSetSize; counter < numValues; counter += pinSetSize)
@@ -148,6 +167,12 @@ TEST(FRC_Basic, alloc_time_malloc)
          alloc_time::malloc_body, workload, false, false, true);
 }
 
+TEST(FRC_Basic, alloc_time_pool)
+{
+    test("alloc_time",
+         alloc_time::pool_body, workload, false, false, false);
+}
+
 TEST(FRC_Basic, alloc_time_std)
 {
     test("alloc_time",
@@ -190,6 +215,12 @@ TEST(FRC_Basic, alloc_time_th_malloc)
          alloc_time::malloc_body, threads, false, false, true);
 }
 
+TEST(FRC_Basic, alloc_time_th_pool)
+{
+    test("alloc_time_th",
+         alloc_time::pool_body, threads, false, false, false);
+}
+
 TEST(FRC_Basic, alloc_time_th_std)
 {
     test("alloc_time_th",
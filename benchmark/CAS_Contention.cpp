@@ -0,0 +1,115 @@
+/*
+ * File: CAS_Contention.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <synchronization/MutexSpin.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace cas_contention
+{
+static constexpr lng numOps = 1 << 17;
+
+struct Node
+{
+    lng value;
+
+    explicit Node(lng value) : value(value)
+    {
+        ;
+    }
+};
+
+/**
+ * All threads repeatedly replace a single shared pointer with a copy of its
+ * target incremented by one. Checks that no update was lost and reports the
+ * aggregate update throughput.
+ */
+template<class Update>
+void test(std::string testName, Update update)
+{
+    FRCToken token;
+    lng numThreads = std::max((lng) 2, (lng) hardwareConcurrency());
+
+    AtomicPointer<Node> shared(0);
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            threadBarrier.wait();
+            for(lng i = 0; i < numOps; ++i)
+                update(shared);
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    ASSERT_EQ(shared->value, numOps * numThreads);
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numOps * numThreads) / seconds;
+
+    std::cout << testName << ": " << numThreads << " threads, " << throughput
+              << " updates/s" << std::endl;
+
+    std::ofstream ofile("./cas_contention.txt", std::ios::app);
+    ofile << testName << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << throughput << std::endl;
+}
+
+} /* namespace cas_contention */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_CAS_Contention, lock)
+{
+    using namespace terrain::benchmarks::cas_contention;
+    MutexSpin mutex;
+    test("lock", [&](AtomicPointer<Node>& shared)
+    {
+        PrivatePointer<Node> next;
+        auto lock = mutex.acquire();
+        next.make(shared->value + 1);
+        shared = next;
+    });
+}
+
+TEST(FRC_CAS_Contention, cas)
+{
+    using namespace terrain::benchmarks::cas_contention;
+    test("cas", [](AtomicPointer<Node>& shared)
+    {
+        shared.update([](PrivatePointer<Node> const& current)
+        {
+            return PrivatePointer<Node>(current->value + 1);
+        });
+    });
+}
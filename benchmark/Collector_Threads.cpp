@@ -0,0 +1,129 @@
+/*
+ * File: Collector_Threads.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <util/FastRNG.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace collector_threads
+{
+static constexpr lng numOps = 1 << 18;
+static constexpr lng numSlots = 1024;
+static constexpr lng nodeSize = 8;
+
+struct Node
+{
+    lng values[nodeSize];
+    AtomicPointer<Node> next;
+
+    explicit Node(lng value)
+    {
+        for(auto& v : values)
+            v = value;
+    }
+};
+
+/**
+ * Mutators replace random slots with freshly made two-node chains, so that every
+ * operation produces garbage with a cascading destructor. Reports throughput and
+ * the 99th percentile latency of a single mutator operation.
+ */
+void test(std::string testName, sz numCollectors)
+{
+    FRCToken token;
+    lng numMutators = std::max((lng) 2, (lng) hardwareConcurrency());
+
+    std::unique_ptr<AtomicPointer<Node>[]> slots(new AtomicPointer<Node>[numSlots]);
+    std::vector<std::vector<double>> latencies(numMutators);
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numMutators + 1);
+
+    startCollectors(numCollectors);
+
+    for(lng t = 0; t < numMutators; ++t)
+    {
+        threads.emplace_back([&](lng t2)
+        {
+            FRCToken tkn;
+            auto& local = latencies[t2];
+            local.reserve(numOps);
+
+            threadBarrier.wait();
+            for(lng i = 0; i < numOps; ++i)
+            {
+                auto tic = high_resolution_clock::now();
+                PrivatePointer<Node> node;
+                node.make(i);
+                node->next.make(i + 1);
+                slots[FastRNG::next(numSlots)] = node;
+                auto toc = high_resolution_clock::now();
+                local.push_back(duration_cast<duration<double, std::nano>>(toc - tic).count());
+            }
+        }, t);
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    stopCollectors();
+
+    std::vector<double> all;
+    for(auto& local : latencies)
+        all.insert(all.end(), local.begin(), local.end());
+    auto p99 = all.begin() + (all.size() * 99) / 100;
+    std::nth_element(all.begin(), p99, all.end());
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numOps * numMutators) / seconds;
+
+    std::cout << testName << ": " << numCollectors << " collectors, " << throughput
+              << " ops/s, p99 " << *p99 << " ns" << std::endl;
+
+    std::ofstream ofile("./collector_threads.txt", std::ios::app);
+    ofile << numCollectors << "," << std::scientific << std::setprecision(10)
+          << throughput << "," << *p99 << std::endl;
+}
+
+} /* namespace collector_threads */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Collector_Threads, collectors_0)
+{
+    terrain::benchmarks::collector_threads::test("collectors_0", 0);
+}
+
+TEST(FRC_Collector_Threads, collectors_1)
+{
+    terrain::benchmarks::collector_threads::test("collectors_1", 1);
+}
+
+TEST(FRC_Collector_Threads, collectors_n)
+{
+    terrain::benchmarks::collector_threads::test("collectors_n",
+            std::max((terrain::sz) 2, terrain::hardwareConcurrency() / 2));
+}
@@ -0,0 +1,122 @@
+/*
+ * File: Concurrent_List.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <util/FastRNG.h>
+
+#include "./cds/BST.h"
+#include "./cds/HarrisList.h"
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+using FRC_LIST = terrain::cds::HarrisList<lng, lng>;
+using FRC_BST = terrain::cds::BST<lng, lng, frc::AtomicPointer, frc::PrivatePointer>;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace concurrent_list
+{
+static constexpr lng numOps = 1 << 16;
+static constexpr lng keyRange = 512; //small enough that a list is a fair comparison
+
+/**
+ * Threads run a mix of 50% finds, 25% inserts and 25% removes on random keys over
+ * a half-full set. Reports aggregate throughput, and checks that the final size
+ * agrees with the successful inserts and removes.
+ */
+template<class DataStruct>
+void test(std::string testName)
+{
+    FRCToken token;
+    lng numThreads = std::max((lng) 2, (lng) hardwareConcurrency());
+
+    DataStruct dataStruct;
+    for(lng key = 0; key < keyRange; key += 2)
+        dataStruct.insert(key, key);
+
+    atm<lng> size(keyRange / 2);
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            lng delta = 0;
+
+            threadBarrier.wait();
+            for(lng i = 0; i < numOps; ++i)
+            {
+                lng key = FastRNG::next(keyRange);
+                lng value;
+                switch(FastRNG::next(4))
+                {
+                    case 0:
+                        delta += dataStruct.insert(key, key);
+                        break;
+                    case 1:
+                        delta -= dataStruct.remove(key);
+                        break;
+                    default:
+                        if(dataStruct.find(key, value))
+                        {
+                            ASSERT_EQ(value, key);
+                        }
+                        break;
+                }
+            }
+            size.fetch_add(delta, orlx);
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    ASSERT_EQ((lng) dataStruct.count(), size.load(oacq));
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numOps * numThreads) / seconds;
+
+    std::cout << testName << ": " << numThreads << " threads, " << throughput
+              << " ops/s" << std::endl;
+
+    std::ofstream ofile("./concurrent_list.txt", std::ios::app);
+    ofile << testName << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << throughput << std::endl;
+}
+
+} /* namespace concurrent_list */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_CDS, list_mixed_test_harris)
+{
+    terrain::benchmarks::concurrent_list::test<FRC_LIST>("harris_list");
+}
+
+TEST(FRC_CDS, list_mixed_test_bst)
+{
+    terrain::benchmarks::concurrent_list::test<FRC_BST>("bst");
+}
@@ -110,7 +110,7 @@ static auto frc_s_m_body = [&](lng numValues, double& time)
 static auto frc_p_m_body = [&](lng numValues, double& time)
 {
     time = 0.;
-    static constexpr lng pinSetSize = terrain::frc::detail::FRCConstants::pinSetSize;
+    static constexpr lng pinSetSize = terrain::frc::detail::FRCConstants::pinBlockSize;
     high_resolution_clock::time_point tic, toc;
 
     for(lng counter = pinSetSize; counter < numValues; counter += pinSetSize)
@@ -129,6 +129,96 @@ static auto frc_p_m_body = [&](lng numValues, double& time)
     }
 };
 
+static constexpr lng numSweepObjects = 1 << 22;
+
+template<sz size>
+struct SweepNode
+{
+    lng values[size];
+
+    explicit SweepNode(lng value)
+    {
+        for(auto& v : values)
+            v = value;
+    }
+};
+
+/**
+ * Drops millions of cold objects of interleaved types in random order and times
+ * their release and destruction, reporting ns/object.
+ */
+static void sweepTest(std::string testName)
+{
+    FRCToken token;
+    std::unique_ptr<AtomicPointer<SweepNode<1>>[]> small(new AtomicPointer<SweepNode<1>>[numSweepObjects]);
+    std::unique_ptr<AtomicPointer<SweepNode<3>>[]> medium(new AtomicPointer<SweepNode<3>>[numSweepObjects]);
+    std::unique_ptr<AtomicPointer<SweepNode<7>>[]> large(new AtomicPointer<SweepNode<7>>[numSweepObjects]);
+
+    std::vector<lng> order(numSweepObjects);
+    for(lng i = 0; i < numSweepObjects; ++i)
+    {
+        order[i] = i;
+        switch(i % 3)
+        {
+            case 0:
+                small[i].make(i);
+                break;
+            case 1:
+                medium[i].make(i);
+                break;
+            default:
+                large[i].make(i);
+                break;
+        }
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(numSweepObjects));
+
+    //dropping triggers inline sweeps, so time the drops and the final collection together
+    auto tic = high_resolution_clock::now();
+    for(auto i : order)
+    {
+        small[i] = nullptr;
+        medium[i] = nullptr;
+        large[i] = nullptr;
+    }
+    frc::detail::FRCManager::collect();
+    auto toc = high_resolution_clock::now();
+
+    double nsPerObject = duration_cast<duration<double, std::nano>>(toc - tic).count() /
+                         numSweepObjects;
+    std::cout << testName << ": " << nsPerObject << " ns/object" << std::endl;
+
+    std::ofstream ofile("./" + testName + ".txt", std::ios::app);
+    ofile << std::scientific << std::setprecision(10) << nsPerObject << std::endl;
+}
+
+static constexpr lng numArrays = 1 << 12;
+
+/**
+ * Releases large arrays made with makeArray() and times their release and
+ * destruction, reporting ns/array.
+ */
+template<typename Cell>
+static void arrayTest(std::string testName, lng arrayLength)
+{
+    FRCToken token;
+    std::unique_ptr<SharedPointer<Cell>[]> arrays(new SharedPointer<Cell>[numArrays]);
+    for(lng i = 0; i < numArrays; ++i)
+        arrays[i].makeArray(arrayLength, false);
+
+    auto tic = high_resolution_clock::now();
+    for(lng i = 0; i < numArrays; ++i)
+        arrays[i] = nullptr;
+    frc::detail::FRCManager::collect();
+    auto toc = high_resolution_clock::now();
+
+    double nsPerArray = duration_cast<duration<double, std::nano>>(toc - tic).count() / numArrays;
+    std::cout << testName << ": " << nsPerArray << " ns/array" << std::endl;
+
+    std::ofstream ofile("./" + testName + ".txt", std::ios::app);
+    ofile << std::scientific << std::setprecision(10) << nsPerArray << std::endl;
+}
+
 TEST(FRC_Basic, dealloc_time_malloc)
 {
     test("dealloc_time", malloc_body, workload, false, false, true);
@@ -189,6 +279,21 @@ TEST(FRC_Basic, dealloc_time_th_frc_p_m)
     test("dealloc_time_th", frc_p_m_body, threads, true, true, false);
 }
 
+TEST(FRC_Basic, dealloc_time_frc_sweep)
+{
+    sweepTest("dealloc_time_sweep");
+}
+
+TEST(FRC_Basic, dealloc_time_frc_array_trivial)
+{
+    arrayTest<lng>("dealloc_time_array_trivial", 1 << 12);
+}
+
+TEST(FRC_Basic, dealloc_time_frc_array_small_trivial)
+{
+    arrayTest<lng>("dealloc_time_array_small_trivial", 32); //pooled
+}
+
 } /* namespace dealloc_time */
 } /* namespace basic */
 } /* namespace benchmarks */
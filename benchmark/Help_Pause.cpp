@@ -0,0 +1,147 @@
+/*
+ * File: Help_Pause.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <algorithm>
+#include <iomanip>
+#include <util/getticks.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace help_pause
+{
+static constexpr lng numThreads = 8;
+static constexpr lng numIters = 64 * 1024;
+
+/**
+ * Results are written per help budget, see FRCConstants::helpBudgetTicks.
+ */
+static std::string const testName = frc::detail::FRCConstants::helpBudgetTicks != 0 ?
+                                    "help_pause_budgeted" : "help_pause_unbudgeted";
+
+static atm<lng> numLive(0);
+
+/**
+ * Its destructor spins for destructorNanoseconds and releases a child, so a
+ * sweep block of them takes a while and cascades into the next epochs.
+ */
+template<lng destructorNanoseconds>
+struct Heavy
+{
+    AtomicPointer<Heavy> child;
+
+    Heavy()
+    {
+        numLive.fetch_add(1, orlx);
+    }
+
+    ~Heavy()
+    {
+        auto until = high_resolution_clock::now() + nanoseconds(destructorNanoseconds);
+        while(high_resolution_clock::now() < until)
+            ;
+        numLive.fetch_sub(1, orlx);
+    }
+};
+
+/**
+ * Every thread keeps replacing the object in its own slot, timing each
+ * replacement, which includes any help call it triggers. Reports the
+ * distribution of those pauses.
+ */
+template<lng destructorNanoseconds>
+void test(std::string workload)
+{
+    using Type = Heavy<destructorNanoseconds>;
+
+    FRCToken token;
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+    std::vector<std::vector<ticks>> pauses(numThreads);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            FRCToken tkn;
+            AtomicPointer<Type> slot;
+            auto& threadPauses = pauses[t];
+            threadPauses.reserve(numIters);
+
+            threadBarrier.wait();
+            for(lng i = 0; i < numIters; ++i)
+            {
+                auto tic = getticks();
+                slot.make();
+                slot->child.make();
+                threadPauses.push_back(getticks() - tic);
+            }
+        });
+    }
+
+    threadBarrier.wait();
+    auto ticStart = getticks();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto ticEnd = getticks();
+    auto toc = high_resolution_clock::now();
+
+    for(lng i = 0; i < 1024 && numLive.load(oacq) != 0; ++i)
+        frc::detail::FRCManager::collect();
+    ASSERT_EQ(numLive.load(oacq), 0);
+
+    std::vector<ticks> all;
+    for(auto& threadPauses : pauses)
+        all.insert(all.end(), threadPauses.begin(), threadPauses.end());
+    std::sort(all.begin(), all.end());
+
+    double micros = duration_cast<duration<double, std::micro>>(toc - tic).count();
+    double microsPerTick = micros / (ticEnd - ticStart);
+    auto percentile = [&](double p)
+    {
+        return all[std::min(all.size() - 1, (sz)(p * all.size()))] * microsPerTick;
+    };
+
+    std::cout << testName << " " << workload << ": p50 " << percentile(0.5) << " us, p99 "
+              << percentile(0.99) << " us, p999 " << percentile(0.999) << " us, max "
+              << all.back() * microsPerTick << " us" << std::endl;
+
+    std::ofstream ofile("./help_pause.txt", std::ios::app);
+    ofile << testName << "," << workload << "," << std::scientific << std::setprecision(10)
+          << percentile(0.5) << "," << percentile(0.99) << "," << percentile(0.999) << ","
+          << all.back() * microsPerTick << std::endl;
+}
+
+} /* namespace help_pause */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Help_Pause, destructor_1us)
+{
+    terrain::benchmarks::help_pause::test<1000>("destructor_1us");
+}
+
+TEST(FRC_Help_Pause, destructor_10us)
+{
+    terrain::benchmarks::help_pause::test<10000>("destructor_10us");
+}
@@ -0,0 +1,137 @@
+/*
+ * File: Help_Policy.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace help_policy
+{
+static constexpr lng numThreads = 16;
+static constexpr lng numIters = 256 * 1024;
+static constexpr lng batchSize = 64;
+
+static atm<lng> numLive(0);
+
+struct Counted
+{
+    lng values[8];
+
+    Counted()
+    {
+        numLive.fetch_add(1, orlx);
+    }
+
+    ~Counted()
+    {
+        numLive.fetch_sub(1, orlx);
+    }
+};
+
+/**
+ * The reclamation workload under each help policy: every thread keeps
+ * replacing the object in its own slot. Reports objects reclaimed per second,
+ * the largest number of outstanding decrements any one thread's log held, and
+ * the slowest batch of batchSize replacements, which is where inline help shows.
+ */
+void test(std::string policyName, HelpPolicyType type)
+{
+    FRCToken token;
+    setHelpPolicy(type);
+
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+    atm<sz> logHighWater(0);
+    atm<lng> slowestBatch(0);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            AtomicPointer<Counted> slot;
+            sz highWater = 0;
+            lng slowest = 0;
+
+            threadBarrier.wait();
+            for(lng i = 0; i < numIters; i += batchSize)
+            {
+                auto tic = high_resolution_clock::now();
+                for(lng j = 0; j < batchSize; ++j)
+                    slot.make();
+                auto toc = high_resolution_clock::now();
+
+                slowest = std::max(slowest, (lng) duration_cast<nanoseconds>(toc - tic).count());
+                highWater = std::max(highWater, frc::detail::threadData->getNumOutstandingDecrements());
+            }
+
+            auto seen = logHighWater.load(orlx);
+            while(seen < highWater && !logHighWater.compare_exchange_weak(seen, highWater, orlx))
+                ;
+            auto seenBatch = slowestBatch.load(orlx);
+            while(seenBatch < slowest && !slowestBatch.compare_exchange_weak(seenBatch, slowest, orlx))
+                ;
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    for(lng i = 0; i < 1024 && numLive.load(oacq) != 0; ++i)
+        frc::detail::FRCManager::collect();
+    auto toc = high_resolution_clock::now();
+
+    setHelpPolicy(frc::detail::FRCConstants::defaultHelpPolicy);
+    ASSERT_EQ(numLive.load(oacq), 0);
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numIters * numThreads) / seconds;
+    double slowestMicros = slowestBatch.load() / 1000.0;
+
+    std::cout << policyName << ": " << throughput << " objects/s, log high-water "
+              << logHighWater.load() << " decrements, slowest batch " << slowestMicros << " us" << std::endl;
+
+    std::ofstream ofile("./help_policy.txt", std::ios::app);
+    ofile << policyName << "," << std::scientific << std::setprecision(10)
+          << throughput << "," << logHighWater.load() << "," << slowestMicros << std::endl;
+}
+
+} /* namespace help_policy */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Help_Policy, log_size)
+{
+    terrain::benchmarks::help_policy::test("log_size", HelpPolicyType::logSize);
+}
+
+TEST(FRC_Help_Policy, bytes_in_flight)
+{
+    terrain::benchmarks::help_policy::test("bytes_in_flight", HelpPolicyType::bytesInFlight);
+}
+
+TEST(FRC_Help_Policy, latency)
+{
+    terrain::benchmarks::help_policy::test("latency", HelpPolicyType::latency);
+}
@@ -0,0 +1,154 @@
+/*
+ * File: Memory_Budget.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <cstring>
+#include <iomanip>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace memory_budget
+{
+static constexpr lng numThreads = 8;
+static constexpr lng numIters = 2048;
+static constexpr sz softLimit = sz(64) << 20;
+static constexpr sz hardLimit = sz(128) << 20;
+
+static atm<lng> numLive(0);
+
+/**
+ * Big enough to be malloc'd (and mmap'd) on its own, and touched, so its
+ * pages count towards RSS until it is reclaimed.
+ */
+struct Large
+{
+    byte bytes[256 * 1024];
+
+    Large()
+    {
+        memset(bytes, 1, sizeof(bytes));
+        numLive.fetch_add(1, orlx);
+    }
+
+    ~Large()
+    {
+        numLive.fetch_sub(1, orlx);
+    }
+};
+
+/**
+ * Linux only: 0 where /proc is unavailable.
+ */
+static sz getResidentBytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    sz size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Every thread keeps replacing the large object in its own slot, while a
+ * sampler tracks the process's RSS. Reports the peak RSS growth over the
+ * run, with or without a memory budget.
+ */
+void test(std::string testName, bool budgeted)
+{
+    FRCToken token;
+    frc::detail::FRCManager::collect();
+    auto baseline = getResidentBytes();
+    auto heapBaseline = getHeapBytes();
+
+    atm<lng> numCallbacks(0);
+    if(budgeted)
+    {
+        setMemoryBudget(heapBaseline + softLimit, heapBaseline + hardLimit, [&](MemoryPressure, sz)
+        {
+            numCallbacks.fetch_add(1, orlx);
+        });
+    }
+
+    atm<bool> done(false);
+    sz peak = baseline;
+    std::thread sampler([&]()
+    {
+        while(!done.load(oacq))
+        {
+            peak = std::max(peak, getResidentBytes());
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+    });
+
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            AtomicPointer<Large> slot;
+            threadBarrier.wait();
+            for(lng i = 0; i < numIters; ++i)
+                slot.make();
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    done.store(true, orls);
+    sampler.join();
+
+    setMemoryBudget(0, 0);
+    for(lng i = 0; i < 1024 && numLive.load(oacq) != 0; ++i)
+        frc::detail::FRCManager::collect();
+    ASSERT_EQ(numLive.load(oacq), 0);
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numIters * numThreads) / seconds;
+    double peakMB = (double)(peak - baseline) / (1 << 20);
+
+    std::cout << testName << ": peak RSS growth " << peakMB << " MB, " << throughput
+              << " objects/s, " << numCallbacks.load() << " pressure callbacks" << std::endl;
+
+    std::ofstream ofile("./memory_budget.txt", std::ios::app);
+    ofile << testName << "," << std::scientific << std::setprecision(10)
+          << peakMB << "," << throughput << "," << numCallbacks.load() << std::endl;
+}
+
+} /* namespace memory_budget */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Memory_Budget, unbudgeted)
+{
+    terrain::benchmarks::memory_budget::test("unbudgeted", false);
+}
+
+TEST(FRC_Memory_Budget, budgeted)
+{
+    terrain::benchmarks::memory_budget::test("budgeted", true);
+}
@@ -0,0 +1,138 @@
+/*
+ * File: Overflow_Spill.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace overflow_spill
+{
+static constexpr lng numIdleThreads = 64;
+static constexpr lng numIters = 2 * 1024 * 1024;
+static constexpr lng batchSize = 1024;
+
+/**
+ * Results are written per overflow mode, see FRCConstants::enableOverflowSpill.
+ */
+static std::string const testName = frc::detail::FRCConstants::enableOverflowSpill ?
+                                    "overflow_spill" : "overflow_blocking";
+
+static atm<lng> numLive(0);
+
+/**
+ * Releasing one logs a decrement for each of its children, so sweeping the
+ * producer's log refills it.
+ */
+struct Node
+{
+    AtomicPointer<Node> children[8];
+
+    Node()
+    {
+        numLive.fetch_add(1, orlx);
+    }
+
+    ~Node()
+    {
+        numLive.fetch_sub(1, orlx);
+    }
+};
+
+/**
+ * One producer keeps replacing a node with fanout fresh children, among idle
+ * threads that are registered but never help. The producer does most of the
+ * collection work by itself, and its log runs into
+ * maxLogSizeBeforeBlockingHelpCall. Reports its throughput and its slowest
+ * batch of replacements.
+ */
+template<lng fanout>
+void test(std::string workload)
+{
+    FRCToken token;
+    atm<bool> done(false);
+    std::vector<std::thread> idleThreads;
+    for(lng t = 0; t < numIdleThreads; ++t)
+    {
+        idleThreads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            while(!done.load(oacq))
+                std::this_thread::sleep_for(milliseconds(1));
+        });
+    }
+
+    double slowestBatch = 0;
+    auto tic = high_resolution_clock::now();
+    std::thread producer([&]()
+    {
+        FRCToken tkn;
+        AtomicPointer<Node> slot;
+        for(lng i = 0; i < numIters; i += batchSize)
+        {
+            auto batchTic = high_resolution_clock::now();
+            for(lng j = 0; j < batchSize; ++j)
+            {
+                slot.make();
+                for(lng k = 0; k < fanout; ++k)
+                    slot->children[k].make();
+            }
+            auto batchToc = high_resolution_clock::now();
+            slowestBatch = std::max(slowestBatch,
+                                    duration_cast<duration<double, std::micro>>(batchToc - batchTic).count());
+        }
+    });
+    producer.join();
+    auto toc = high_resolution_clock::now();
+
+    done.store(true, orls);
+    for(auto& t : idleThreads)
+        t.join();
+
+    for(lng i = 0; i < 1024 && numLive.load(oacq) != 0; ++i)
+        frc::detail::FRCManager::collect();
+    ASSERT_EQ(numLive.load(oacq), 0);
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = numIters * (fanout + 1) / seconds;
+
+    std::cout << testName << " " << workload << ": " << throughput << " objects/s, slowest batch "
+              << slowestBatch << " us" << std::endl;
+
+    std::ofstream ofile("./overflow_spill.txt", std::ios::app);
+    ofile << testName << "," << workload << "," << std::scientific << std::setprecision(10)
+          << throughput << "," << slowestBatch << std::endl;
+}
+
+} /* namespace overflow_spill */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Overflow_Spill, fanout_4)
+{
+    terrain::benchmarks::overflow_spill::test<4>("fanout_4");
+}
+
+TEST(FRC_Overflow_Spill, fanout_8)
+{
+    terrain::benchmarks::overflow_spill::test<8>("fanout_8");
+}
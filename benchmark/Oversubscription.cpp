@@ -0,0 +1,239 @@
+/*
+ * File: Oversubscription.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <util/FastRNG.h>
+
+#include "./cds/BST.h"
+#include "./cds/HarrisList.h"
+#include "./cds/HashMapCPC.h"
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+using FRC_LIST = terrain::cds::HarrisList<lng, lng>;
+using FRC_BST = terrain::cds::BST<lng, lng, frc::AtomicPointer, frc::PrivatePointer>;
+using FRC_HMap = terrain::cds::HashMapCPC<lng, lng, frc::AtomicPointer, frc::PrivatePointer, 64, 8192>;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace oversubscription
+{
+static constexpr lng threadsPerCore = 4;
+static constexpr lng numOps = 1 << 17; //per thread
+static constexpr lng batchSize = 1024;
+static constexpr lng keyRange = 512;
+static constexpr lng quotaPeriodMicroseconds = 10000;
+static constexpr lng throttleMicroseconds = 5000; //of each period, for throttled threads
+
+/**
+ * Results are written per stall handling, see FRCConstants::taskStallTicks.
+ */
+static std::string const testName = frc::detail::FRCConstants::taskStallTicks != 0 ?
+                                    "oversubscribed_takeover" : "oversubscribed_blocking";
+
+/**
+ * Deschedules the signalled thread wherever it was, as a CPU quota running
+ * out does.
+ */
+static void throttle(int)
+{
+    timespec pause{0, throttleMicroseconds * 1000};
+    nanosleep(&pause, nullptr);
+}
+
+static atm<bool> parkArmed(false);
+
+/**
+ * Installed as a ThreadData hook: once armed, deschedules the next helper to
+ * reach it for throttleMicroseconds, at a chosen point of its task.
+ */
+static void park()
+{
+    if(parkArmed.load(orlx) && parkArmed.exchange(false, oacq))
+        std::this_thread::sleep_for(microseconds(throttleMicroseconds));
+}
+
+/**
+ * Runs the Concurrent_* mix of 50% finds, 25% inserts and 25% removes with
+ * threadsPerCore threads per hardware thread, calling disturb(threads) every
+ * quota period. Reports aggregate throughput and the slowest batch of
+ * operations, which is where a thread that blocks on a descheduled helper
+ * shows up.
+ */
+template<class DataStruct, class Disturb>
+void run(std::string const& name, std::string const& workload, Disturb&& disturb)
+{
+    FRCToken token;
+    lng numThreads = threadsPerCore * std::max((lng) 1, (lng) hardwareConcurrency());
+
+    struct sigaction action = {};
+    struct sigaction previous;
+    action.sa_handler = throttle;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, &previous);
+
+    DataStruct dataStruct;
+    for(lng key = 0; key < keyRange; key += 2)
+        dataStruct.insert(key, key);
+
+    atm<lng> numFinished(0);
+    std::vector<double> slowestBatches(numThreads, 0);
+    std::vector<high_resolution_clock::time_point> finishTimes(numThreads);
+    std::vector<std::thread> threads;
+    boost::barrier startBarrier(numThreads + 1);
+    boost::barrier exitBarrier(numThreads + 1);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            FRCToken tkn;
+
+            startBarrier.wait();
+            for(lng i = 0; i < numOps; i += batchSize)
+            {
+                auto batchTic = high_resolution_clock::now();
+                for(lng j = 0; j < batchSize; ++j)
+                {
+                    lng key = FastRNG::next(keyRange);
+                    lng value;
+                    switch(FastRNG::next(4))
+                    {
+                        case 0:
+                            dataStruct.insert(key, key);
+                            break;
+                        case 1:
+                            dataStruct.remove(key);
+                            break;
+                        default:
+                            if(dataStruct.find(key, value))
+                            {
+                                EXPECT_EQ(value, key);
+                            }
+                            break;
+                    }
+                }
+                auto batchToc = high_resolution_clock::now();
+                slowestBatches[t] = std::max(slowestBatches[t],
+                                             duration_cast<duration<double, std::micro>>(batchToc - batchTic).count());
+            }
+            finishTimes[t] = high_resolution_clock::now();
+            numFinished.fetch_add(1, orls);
+
+            //stays signallable until the throttling stops
+            exitBarrier.wait();
+        });
+    }
+
+    startBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    while(numFinished.load(oacq) != numThreads)
+    {
+        std::this_thread::sleep_for(microseconds(quotaPeriodMicroseconds));
+        disturb(threads);
+    }
+    exitBarrier.wait();
+    for(auto& t : threads)
+        t.join();
+    sigaction(SIGUSR1, &previous, nullptr);
+
+    auto toc = *std::max_element(finishTimes.begin(), finishTimes.end());
+    double slowestBatch = *std::max_element(slowestBatches.begin(), slowestBatches.end());
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numOps * numThreads) / seconds;
+
+    std::cout << name << " " << workload << ": " << numThreads << " threads, " << throughput
+              << " ops/s, slowest batch " << slowestBatch << " us" << std::endl;
+
+    std::ofstream ofile("./oversubscription.txt", std::ios::app);
+    ofile << name << "," << workload << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << throughput << "," << slowestBatch << std::endl;
+}
+
+/**
+ * Every quota period, a random quarter of the threads is throttled for
+ * throttleMicroseconds, which stands in for a container's CPU quota: the
+ * cgroup controls that would impose one need privileges benchmarks don't have.
+ */
+template<class DataStruct>
+void test(std::string const& workload)
+{
+    run<DataStruct>(testName, workload, [](std::vector<std::thread>& threads)
+    {
+        lng numThreads = threads.size();
+        for(lng i = 0; i < std::max((lng) 1, numThreads / 4); ++i)
+            pthread_kill(threads[FastRNG::next(numThreads)].native_handle(), SIGUSR1);
+    });
+}
+
+/**
+ * Every quota period, the next helper to reach hook is descheduled there for
+ * throttleMicroseconds. A parked sweeper's block can be taken over; a parked
+ * scanner's can't, and every other thread waits on it in help() (see
+ * HelpRouter::tryHelpStalled()).
+ */
+template<class DataStruct>
+void testParked(std::string const& name, std::string const& workload, atm<void (*)()>& hook)
+{
+    hook.store(&park, orls);
+    run<DataStruct>(name, workload, [](std::vector<std::thread>&)
+    {
+        parkArmed.store(true, orls);
+    });
+    hook.store(nullptr, orls);
+    parkArmed.store(false, orls);
+}
+
+} /* namespace oversubscription */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Oversubscription, hashmap_mixed)
+{
+    terrain::benchmarks::oversubscription::test<FRC_HMap>("hashmap");
+}
+
+TEST(FRC_Oversubscription, bst_mixed)
+{
+    terrain::benchmarks::oversubscription::test<FRC_BST>("bst");
+}
+
+TEST(FRC_Oversubscription, list_mixed)
+{
+    terrain::benchmarks::oversubscription::test<FRC_LIST>("harris_list");
+}
+
+TEST(FRC_Oversubscription, parked_sweeper)
+{
+    terrain::benchmarks::oversubscription::testParked<FRC_HMap>(
+        "parked_sweeper", "hashmap", frc::detail::ThreadData::sweepClaimedHook);
+}
+
+TEST(FRC_Oversubscription, parked_scanner)
+{
+    terrain::benchmarks::oversubscription::testParked<FRC_HMap>(
+        "parked_scanner", "hashmap", frc::detail::ThreadData::scanClaimedHook);
+}
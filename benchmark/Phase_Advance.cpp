@@ -0,0 +1,117 @@
+/*
+ * File: Phase_Advance.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace phase_advance
+{
+static constexpr lng numCollects = 256;
+static constexpr lng stepsPerCollect = 16; //see HelpRouter::collect()
+using Type = lng;
+
+/**
+ * Registers numThreads idle threads, each holding numPins (null) pins, then
+ * times how long the main thread takes to drive the collector through its
+ * steps. Every registered thread is scanned and swept each step, so this is
+ * the per-thread cost on the critical path to advancing.
+ */
+void test(std::string testName, lng numThreads, sz numPins)
+{
+    FRCToken token;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    boost::barrier threadBarrier(numThreads + 1);
+
+    std::vector<std::thread> threads;
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            std::vector<PrivatePointer<Type>> pins(numPins);
+            threadBarrier.wait();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]()
+            {
+                return done;
+            });
+        });
+    }
+
+    threadBarrier.wait();
+    frc::detail::FRCManager::collect(); //settle the newly registered threads
+
+    auto tic = high_resolution_clock::now();
+    for(lng i = 0; i < numCollects; ++i)
+        frc::detail::FRCManager::collect();
+    auto toc = high_resolution_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cv.notify_all();
+    for(auto& t : threads)
+        t.join();
+
+    double micros = duration_cast<duration<double, std::micro>>(toc - tic).count();
+    double latency = micros / (numCollects * stepsPerCollect);
+
+    std::cout << testName << ": " << numThreads << " threads, " << latency
+              << " us per step" << std::endl;
+
+    std::ofstream ofile("./phase_advance.txt", std::ios::app);
+    ofile << testName << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << latency << std::endl;
+}
+
+} /* namespace phase_advance */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Phase_Advance, idle_64)
+{
+    terrain::benchmarks::phase_advance::test("idle", 64, 0);
+}
+
+TEST(FRC_Phase_Advance, idle_256)
+{
+    terrain::benchmarks::phase_advance::test("idle", 256, 0);
+}
+
+TEST(FRC_Phase_Advance, pinned_64)
+{
+    terrain::benchmarks::phase_advance::test("pinned", 64, 4);
+}
+
+TEST(FRC_Phase_Advance, pinned_256)
+{
+    terrain::benchmarks::phase_advance::test("pinned", 256, 4);
+}
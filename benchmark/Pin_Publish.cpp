@@ -0,0 +1,131 @@
+/*
+ * File: Pin_Publish.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include "Basic_Tests.h"
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace basic
+{
+namespace pin_publish
+{
+
+/**
+ * Results are written per pin handshake mode, see
+ * FRCConstants::enableAsymmetricPinFences.
+ */
+static std::string const testName = frc::detail::FRCConstants::enableAsymmetricPinFences ?
+                                    "pin_publish_asymmetric" : "pin_publish_release";
+
+/**
+ * The handshake with a full fence between the busySignal and the load, for
+ * reference: what pinning costs when the mutator orders it by itself.
+ */
+static auto fenced_body = [](lng numValues, double& time)
+{
+    high_resolution_clock::time_point tic, toc;
+
+    atm<Type*> ptrA(new Type(1));
+    atm<Type*> ptrB(new Type(2));
+    atm<void*> pin(nullptr);
+
+    auto pinFrom = [&](atm<Type*>& source)
+    {
+        pin.store((void*) frc::detail::FRCConstants::busySignal, orlx);
+        fence();
+        pin.store(source.load(oacq), orls);
+    };
+
+    tic = high_resolution_clock::now();
+    for(lng i = 0; i < numValues; ++i)
+    {
+        pinFrom(ptrA);
+        pinFrom(ptrB);
+    }
+    toc = high_resolution_clock::now();
+
+    delete ptrA.load();
+    delete ptrB.load();
+
+    time = duration_cast<duration<double, milli >> (toc - tic).count();
+};
+
+static auto frc_ap_body = [](lng numValues, double& time)
+{
+    high_resolution_clock::time_point tic, toc;
+
+    AtomicPointer<Type> ptrA(1);
+    AtomicPointer<Type> ptrB(2);
+    PrivatePointer<Type> ptrC;
+
+    tic = high_resolution_clock::now();
+    for(lng i = 0; i < numValues; ++i)
+    {
+        ptrC = ptrA;
+        ptrC = ptrB;
+    }
+    toc = high_resolution_clock::now();
+
+    time = duration_cast<duration<double, milli >> (toc - tic).count();
+};
+
+static auto frc_mp_body = [](lng numValues, double& time)
+{
+    high_resolution_clock::time_point tic, toc;
+
+    MarkedAtomicPointer<Type> ptrA;
+    MarkedAtomicPointer<Type> ptrB;
+    ptrA.make(1);
+    ptrB.make(2);
+    PrivatePointer<Type> ptrC;
+
+    tic = high_resolution_clock::now();
+    for(lng i = 0; i < numValues; ++i)
+    {
+        ptrA.load(ptrC);
+        ptrB.load(ptrC);
+    }
+    toc = high_resolution_clock::now();
+
+    time = duration_cast<duration<double, milli >> (toc - tic).count();
+};
+
+TEST(FRC_Basic, pin_publish_fenced)
+{
+    test(testName, fenced_body, workload, true, true, true);
+}
+
+TEST(FRC_Basic, pin_publish_frc_ap)
+{
+    test(testName, frc_ap_body, workload, true, true, false);
+}
+
+TEST(FRC_Basic, pin_publish_frc_mp)
+{
+    test(testName, frc_mp_body, workload, true, true, false);
+}
+
+} /* namespace pin_publish */
+} /* namespace basic */
+} /* namespace benchmarks */
+} /* namespace terrain */
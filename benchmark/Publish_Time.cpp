@@ -0,0 +1,125 @@
+/*
+ * File: Publish_Time.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <util/FastRNG.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace publish_time
+{
+static constexpr lng numOps = 1 << 20;
+static constexpr lng numSlots = 1024;
+
+struct Node
+{
+    lng key;
+    lng value;
+
+    Node(lng key, lng value) : key(key), value(value)
+    {
+        ;
+    }
+};
+
+/**
+ * Threads repeatedly allocate a node and publish it into a random shared slot,
+ * the "allocate, initialize, then link" pattern of the cds inserts.
+ * Reports the mean time per publish.
+ */
+template<class Publish>
+void test(std::string testName, lng numThreads, Publish publish)
+{
+    FRCToken token;
+    std::unique_ptr<AtomicPointer<Node>[]> slots(new AtomicPointer<Node>[numSlots]);
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            threadBarrier.wait();
+            for(lng i = 0; i < numOps; ++i)
+                publish(slots[FastRNG::next(numSlots)], i);
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    double time = duration_cast<duration<double, std::nano>>(toc - tic).count() / numOps;
+
+    std::cout << testName << ": " << numThreads << " threads, " << time
+              << " ns/publish" << std::endl;
+
+    std::ofstream ofile("./publish_time.txt", std::ios::app);
+    ofile << testName << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << time << std::endl;
+}
+
+template<class Publish>
+void test(std::string testName, Publish publish)
+{
+    test(testName, 1, publish);
+    test(testName + "_th", std::max((lng) 2, (lng) hardwareConcurrency()), publish);
+}
+
+} /* namespace publish_time */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Publish_Time, copy)
+{
+    using namespace terrain::benchmarks::publish_time;
+    test("copy", [](AtomicPointer<Node>& slot, lng i)
+    {
+        PrivatePointer<Node> node;
+        node.make(i, i);
+        slot = node;
+    });
+}
+
+TEST(FRC_Publish_Time, move)
+{
+    using namespace terrain::benchmarks::publish_time;
+    test("move", [](AtomicPointer<Node>& slot, lng i)
+    {
+        PrivatePointer<Node> node;
+        node.make(i, i);
+        slot = std::move(node);
+    });
+}
+
+TEST(FRC_Publish_Time, make_in_place)
+{
+    using namespace terrain::benchmarks::publish_time;
+    test("make_in_place", [](AtomicPointer<Node>& slot, lng i)
+    {
+        slot.make(i, i);
+    });
+}
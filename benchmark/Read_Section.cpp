@@ -0,0 +1,142 @@
+/*
+ * File: Read_Section.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <util/FastRNG.h>
+
+#include "Concurrent_Struct_Helpers.h"
+#include "./cds/BST.h"
+#include "./cds/BTree.h"
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+using FRC_BST = terrain::cds::BST<lng, lng, frc::AtomicPointer, frc::PrivatePointer>;
+using FRC_BTree = terrain::cds::BTree<lng, lng, frc::AtomicPointer, frc::PrivatePointer, 512, 32, 64>;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace read_section
+{
+static constexpr lng numNodes = 1 << 16;
+static constexpr lng numOps = 1 << 20;
+
+/**
+ * Reader threads look up random keys while one writer removes and reinserts
+ * random keys, so that nodes are reclaimed under the readers. Each lookup
+ * either pins every node it visits (find), or walks raw pointers inside one
+ * ReadSection (findUnprotected). Reports aggregate lookup throughput.
+ */
+template<class DataStruct>
+void test(std::string testName, bool useReadSections)
+{
+    FRCToken token;
+    lng numThreads = std::max((lng) 2, (lng) hardwareConcurrency());
+
+    DataStruct dataStruct;
+    cds::build_random_structs(numNodes, &dataStruct);
+
+    atm<lng> numReaders(numThreads);
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 2);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            threadBarrier.wait();
+            for(lng i = 0; i < numOps; ++i)
+            {
+                lng key = FastRNG::next(numNodes);
+                lng value = -1;
+                bool found;
+                if(useReadSections)
+                {
+                    ReadSection section;
+                    found = dataStruct.findUnprotected(key, value);
+                }
+                else
+                {
+                    found = dataStruct.find(key, value);
+                }
+
+                if(found)
+                {
+                    ASSERT_EQ(value, key);
+                }
+            }
+            numReaders.fetch_sub(1, orls);
+        });
+    }
+
+    threads.emplace_back([&]()
+    {
+        FRCToken tkn;
+        threadBarrier.wait();
+        while(numReaders.load(oacq) != 0)
+        {
+            lng key = FastRNG::next(numNodes);
+            if(dataStruct.remove(key))
+                dataStruct.insert(key, key);
+        }
+    });
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    ASSERT_EQ((lng) dataStruct.count(), numNodes);
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numOps * numThreads) / seconds;
+
+    std::cout << testName << ": " << numThreads << " threads, " << throughput
+              << " lookups/s" << std::endl;
+
+    std::ofstream ofile("./read_section.txt", std::ios::app);
+    ofile << testName << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << throughput << std::endl;
+}
+
+} /* namespace read_section */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Read_Section, bst_pinned)
+{
+    terrain::benchmarks::read_section::test<FRC_BST>("bst_pinned", false);
+}
+
+TEST(FRC_Read_Section, bst_read_section)
+{
+    terrain::benchmarks::read_section::test<FRC_BST>("bst_read_section", true);
+}
+
+TEST(FRC_Read_Section, btree_pinned)
+{
+    terrain::benchmarks::read_section::test<FRC_BTree>("btree_pinned", false);
+}
+
+TEST(FRC_Read_Section, btree_read_section)
+{
+    terrain::benchmarks::read_section::test<FRC_BTree>("btree_read_section", true);
+}
@@ -0,0 +1,118 @@
+/*
+ * File: Reclamation.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace reclamation
+{
+static constexpr lng numIters = 256 * 1024;
+static constexpr lng sampleInterval = 64;
+
+static atm<lng> numLive(0);
+
+struct Counted
+{
+    lng value;
+
+    explicit Counted(lng value) : value(value)
+    {
+        numLive.fetch_add(1, orlx);
+    }
+
+    ~Counted()
+    {
+        numLive.fetch_sub(1, orlx);
+    }
+};
+
+/**
+ * Every thread keeps replacing the object in its own slot, so each iteration
+ * makes one object garbage. The run ends once all of it has been reclaimed.
+ * Reports objects reclaimed per second, and the largest number of
+ * outstanding decrements any one thread's log held (sampled).
+ */
+void test(lng numThreads)
+{
+    FRCToken token;
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+    atm<sz> logHighWater(0);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            AtomicPointer<Counted> slot;
+            sz highWater = 0;
+
+            threadBarrier.wait();
+            for(lng i = 0; i < numIters; ++i)
+            {
+                slot.make(i);
+                if(i % sampleInterval == 0)
+                    highWater = std::max(highWater, frc::detail::threadData->getNumOutstandingDecrements());
+            }
+
+            auto seen = logHighWater.load(orlx);
+            while(seen < highWater && !logHighWater.compare_exchange_weak(seen, highWater, orlx))
+                ;
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    for(lng i = 0; i < 1024 && numLive.load(oacq) != 0; ++i)
+        frc::detail::FRCManager::collect();
+    auto toc = high_resolution_clock::now();
+
+    ASSERT_EQ(numLive.load(oacq), 0);
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numIters * numThreads) / seconds;
+
+    std::cout << "reclamation: " << numThreads << " threads, " << throughput
+              << " objects/s, log high-water " << logHighWater.load() << " decrements" << std::endl;
+
+    std::ofstream ofile("./reclamation.txt", std::ios::app);
+    ofile << numThreads << "," << std::scientific << std::setprecision(10)
+          << throughput << "," << logHighWater.load() << std::endl;
+}
+
+} /* namespace reclamation */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Reclamation, threads_32)
+{
+    terrain::benchmarks::reclamation::test(32);
+}
+
+TEST(FRC_Reclamation, threads_64)
+{
+    terrain::benchmarks::reclamation::test(64);
+}
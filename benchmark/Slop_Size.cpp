@@ -14,6 +14,7 @@
 
 #include <gtest/gtest.h>
 #include <common.h>
+#include <iomanip>
 #include <boost/thread/barrier.hpp>
 #include "Concurrent_Struct_Helpers.h"
 #include "./cds/BST.h"
@@ -100,6 +101,70 @@ void test_2()
         t.join();
 }
 
+static atm<lng> numLive(0);
+
+struct Counted
+{
+    Type value;
+
+    explicit Counted(Type value) : value(value)
+    {
+        numLive.fetch_add(1, orlx);
+    }
+
+    ~Counted()
+    {
+        numLive.fetch_sub(1, orlx);
+    }
+};
+
+/**
+ * Decrement-heavy: every iteration logs one decrement, and the run ends when
+ * all of them have been swept. Reports decrements swept per second, and the
+ * log traffic that implies: each entry is written once and read once.
+ */
+void test_3()
+{
+    FRCToken tkn;
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&](lng t2)
+        {
+            if(numThreads <= hardwareConcurrency())
+                bindToProcessor(t2);
+            FRCToken tkn;
+
+            threadBarrier.wait(); // Get all threads ready to go
+            for(lng i = 0; i < numIters; ++i)
+                AtomicPointer<Counted> ptr(i);
+        }, t);
+    }
+
+    threadBarrier.wait();
+    auto tic = std::chrono::high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    for(lng i = 0; i < 1024 && numLive.load(oacq) != 0; ++i)
+        frc::detail::FRCManager::collect();
+    auto toc = std::chrono::high_resolution_clock::now();
+
+    ASSERT_EQ(numLive.load(oacq), 0);
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(toc - tic).count();
+    double decrementsPerSecond = (numIters * numThreads) / seconds;
+    double logBytesPerSecond = decrementsPerSecond * 2 * sizeof(void*);
+
+    std::cout << "sweep: " << decrementsPerSecond << " decrements/s, "
+              << logBytesPerSecond / (1024 * 1024) << " MB/s of log traffic" << std::endl;
+
+    std::ofstream ofile("./slop_size.txt", std::ios::app);
+    ofile << "sweep," << numThreads << "," << std::scientific << std::setprecision(10)
+          << decrementsPerSecond << "," << logBytesPerSecond << std::endl;
+}
+
 } /* namespace slop_size */
 } /* namespace benchmarks */
 } /* namespace terrain */
@@ -113,3 +178,8 @@ TEST(FRC_Slop, slop_size_2)
 {
     terrain::benchmarks::slop_size::test_2();
 }
+
+TEST(FRC_Slop, sweep_throughput)
+{
+    terrain::benchmarks::slop_size::test_3();
+}
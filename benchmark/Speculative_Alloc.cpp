@@ -0,0 +1,122 @@
+/*
+ * File: Speculative_Alloc.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <util/FastRNG.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace speculative_alloc
+{
+static constexpr lng numOps = 1 << 20;
+static constexpr lng numSlots = 1024;
+
+struct Node
+{
+    lng key;
+    lng value;
+
+    Node(lng key, lng value) : key(key), value(value)
+    {
+        ;
+    }
+};
+
+/**
+ * Threads make a node ahead of each attempt to install it into a random
+ * shared slot, and drop it when the attempt fails, the pattern of lock-free
+ * inserts that allocate before their CAS. One attempt in publishRate succeeds.
+ *
+ * With keepShared, each node is also copied once before the attempt, so that
+ * every failed one goes through the collector as before unshared objects
+ * were destroyed on release.
+ *
+ * Reports the mean time per attempt.
+ */
+void test(std::string testName, lng numThreads, lng publishRate, bool keepShared)
+{
+    FRCToken token;
+    std::unique_ptr<AtomicPointer<Node>[]> slots(new AtomicPointer<Node>[numSlots]);
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            PrivatePointer<Node> copy;
+            threadBarrier.wait();
+            for(lng i = 0; i < numOps; ++i)
+            {
+                PrivatePointer<Node> node;
+                node.make(i, i);
+                if(keepShared)
+                    copy = node;
+                if(FastRNG::next(publishRate) == 0)
+                    slots[FastRNG::next(numSlots)] = std::move(node);
+            }
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    double time = duration_cast<duration<double, std::nano>>(toc - tic).count() / numOps;
+
+    std::cout << testName << ": " << numThreads << " threads, " << time
+              << " ns/attempt" << std::endl;
+
+    std::ofstream ofile("./speculative_alloc.txt", std::ios::app);
+    ofile << testName << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << time << std::endl;
+}
+
+void test(std::string testName, lng publishRate, bool keepShared)
+{
+    test(testName, 1, publishRate, keepShared);
+    test(testName + "_th", std::max((lng) 2, (lng) hardwareConcurrency()), publishRate, keepShared);
+}
+
+} /* namespace speculative_alloc */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Speculative_Alloc, unshared)
+{
+    using namespace terrain::benchmarks::speculative_alloc;
+    test("unshared_1", 1, false);
+    test("unshared_16", 16, false);
+    test("unshared_never", numOps * 2, false);
+}
+
+TEST(FRC_Speculative_Alloc, shared)
+{
+    using namespace terrain::benchmarks::speculative_alloc;
+    test("shared_1", 1, true);
+    test("shared_16", 16, true);
+    test("shared_never", numOps * 2, true);
+}
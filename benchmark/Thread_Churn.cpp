@@ -0,0 +1,111 @@
+/*
+ * File: Thread_Churn.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace thread_churn
+{
+static constexpr lng numWaves = 256;
+static constexpr lng threadsPerWave = 16;
+static constexpr lng opsPerThread = 256;
+using Type = lng;
+
+static sz residentSetSize()
+{
+    sz pages = 0, residentPages = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> residentPages;
+    return residentPages * (sz) sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Spawns waves of short-lived threads that register, do a little FRC work and exit.
+ * A pool capacity of zero reproduces the unpooled behavior (a fresh ThreadData per thread).
+ */
+void test(std::string testName, sz poolCapacity)
+{
+    FRCToken token;
+    frc::detail::FRCManager::setThreadDataPoolCapacity(poolCapacity);
+
+    AtomicPointer<Type> shared(0);
+    std::vector<std::thread> threads;
+
+    auto rssBefore = residentSetSize();
+    auto tic = high_resolution_clock::now();
+
+    for(lng wave = 0; wave < numWaves; ++wave)
+    {
+        threads.clear();
+        for(lng t = 0; t < threadsPerWave; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                FRCToken tkn;
+                AtomicPointer<Type> local;
+                for(lng i = 0; i < opsPerThread; ++i)
+                {
+                    local.make(i);
+                    PrivatePointer<Type> pinned(shared);
+                }
+            });
+        }
+        for(auto& t : threads)
+            t.join();
+    }
+
+    auto toc = high_resolution_clock::now();
+    auto rssAfter = residentSetSize();
+    frc::detail::FRCManager::collect();
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double threadsPerSecond = (numWaves * threadsPerWave) / seconds;
+    double rssGrowth = rssAfter > rssBefore ? (double)(rssAfter - rssBefore) : 0.;
+
+    std::cout << testName << ": " << threadsPerSecond << " threads/s, rss growth "
+              << rssGrowth / (1024 * 1024) << " MB" << std::endl;
+
+    std::ofstream ofile("./thread_churn.txt", std::ios::app);
+    ofile << testName << "," << std::scientific << std::setprecision(10)
+          << threadsPerSecond << "," << rssGrowth << std::endl;
+
+    frc::detail::FRCManager::setThreadDataPoolCapacity(
+        frc::detail::FRCConstants::maxPooledThreadData);
+}
+
+} /* namespace thread_churn */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Thread_Churn, unpooled)
+{
+    terrain::benchmarks::thread_churn::test("unpooled", 0);
+}
+
+TEST(FRC_Thread_Churn, pooled)
+{
+    terrain::benchmarks::thread_churn::test("pooled",
+                                            terrain::frc::detail::FRCConstants::maxPooledThreadData);
+}
@@ -0,0 +1,318 @@
+/*
+ * File: Tree_Rotation.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <common.h>
+#include <iomanip>
+#include <synchronization/MutexSpin.h>
+#include <util/FastRNG.h>
+
+using namespace std::chrono;
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace terrain
+{
+namespace benchmarks
+{
+namespace tree_rotation
+{
+static constexpr lng numOps = 1 << 15;
+static constexpr lng numKeys = 1024;
+static constexpr lng rotationsPerSearch = 4; //one in this many operations rotates
+
+/**
+ * Tree whose edges are CasPointers: a rotation swings its three edges with one
+ * MultiCas, and searches never block.
+ */
+struct CasTree
+{
+    struct Node
+    {
+        lng key;
+        CasPointer<Node> left;
+        CasPointer<Node> right;
+
+        explicit Node(lng key) : key(key)
+        {
+            ;
+        }
+    };
+
+    using Edge = CasPointer<Node>;
+    using Protected = PrivatePointer<Node>;
+
+    CasTree()
+    {
+        head.make(numKeys); //sentinel: the tree hangs off its left edge
+        Protected root;
+        build(root, 0, numKeys);
+        head->left.store(root);
+    }
+
+    bool find(lng key)
+    {
+        Protected curr;
+        Protected next;
+        head->left.load(curr);
+
+        while(curr != nullptr && curr->key != key)
+        {
+            (key < curr->key ? curr->left : curr->right).load(next);
+            curr.swap(next);
+        }
+        return curr != nullptr;
+    }
+
+    /**
+     * Rotates the node on the way to key at which the walk stops (randomly).
+     */
+    bool rotate(lng key)
+    {
+        Protected parent(head);
+        Protected x;
+        Protected y;
+        Protected b;
+        Edge* parentEdge = &parent->left;
+        parentEdge->load(x);
+
+        while(x != nullptr && x->key != key && FastRNG::next(4) != 0)
+        {
+            parentEdge = key < x->key ? &x->left : &x->right;
+            parent.swap(x);
+            parentEdge->load(x);
+        }
+        if(x == nullptr)
+            return false;
+
+        bool leftRotation = FastRNG::next(2) == 0;
+        Edge& down = leftRotation ? x->right : x->left; // x -> y
+        down.load(y);
+        if(y == nullptr)
+            return false;
+        Edge& inner = leftRotation ? y->left : y->right; // y -> b
+        inner.load(b);
+
+        return MultiCas()
+               .add(*parentEdge, x.get(), y)
+               .add(down, y.get(), b)
+               .add(inner, b.get(), x)
+               .execute();
+    }
+
+    sz check()
+    {
+        lng next = 0;
+        checkNode(head->left.get(), next);
+        return next;
+    }
+
+    void build(Protected& node, lng begin, lng end)
+    {
+        if(begin == end)
+            return;
+        lng mid = (begin + end) / 2;
+        node.make(mid);
+        Protected child;
+        build(child, begin, mid);
+        node->left.store(child);
+        child = nullptr;
+        build(child, mid + 1, end);
+        node->right.store(child);
+    }
+
+    void checkNode(Node* node, lng& next)
+    {
+        if(node == nullptr)
+            return;
+        checkNode(node->left.get(), next);
+        EXPECT_EQ(node->key, next);
+        ++next;
+        checkNode(node->right.get(), next);
+    }
+
+    AtomicPointer<Node> head;
+};
+
+/**
+ * The same tree with AtomicPointer edges, rotated under one MutexSpin.
+ */
+struct LockTree
+{
+    struct Node
+    {
+        lng key;
+        AtomicPointer<Node> left;
+        AtomicPointer<Node> right;
+
+        explicit Node(lng key) : key(key)
+        {
+            ;
+        }
+    };
+
+    using Edge = AtomicPointer<Node>;
+    using Protected = PrivatePointer<Node>;
+
+    LockTree()
+    {
+        head.make(numKeys);
+        Protected root;
+        build(root, 0, numKeys);
+        head->left = root;
+    }
+
+    bool find(lng key)
+    {
+        Protected curr(head->left);
+
+        while(curr != nullptr && curr->key != key)
+            curr = key < curr->key ? curr->left : curr->right;
+        return curr != nullptr;
+    }
+
+    bool rotate(lng key)
+    {
+        auto lock = mutex.acquire();
+
+        Protected parent(head);
+        Edge* parentEdge = &parent->left;
+        Protected x(*parentEdge);
+
+        while(x != nullptr && x->key != key && FastRNG::next(4) != 0)
+        {
+            parentEdge = key < x->key ? &x->left : &x->right;
+            parent = x;
+            x = *parentEdge;
+        }
+        if(x == nullptr)
+            return false;
+
+        bool leftRotation = FastRNG::next(2) == 0;
+        Edge& down = leftRotation ? x->right : x->left;
+        Protected y(down);
+        if(y == nullptr)
+            return false;
+        Edge& inner = leftRotation ? y->left : y->right;
+
+        down = inner;
+        inner = x;
+        *parentEdge = y;
+        return true;
+    }
+
+    sz check()
+    {
+        lng next = 0;
+        checkNode(head->left.get(), next);
+        return next;
+    }
+
+    void build(Protected& node, lng begin, lng end)
+    {
+        if(begin == end)
+            return;
+        lng mid = (begin + end) / 2;
+        node.make(mid);
+        Protected child;
+        build(child, begin, mid);
+        node->left = child;
+        child = nullptr;
+        build(child, mid + 1, end);
+        node->right = child;
+    }
+
+    void checkNode(Node* node, lng& next)
+    {
+        if(node == nullptr)
+            return;
+        checkNode(node->left.get(), next);
+        EXPECT_EQ(node->key, next);
+        ++next;
+        checkNode(node->right.get(), next);
+    }
+
+    MutexSpin mutex;
+    AtomicPointer<Node> head;
+};
+
+/**
+ * Threads mix searches with rotations at random points of a shared tree.
+ * Reports aggregate throughput and the number of committed rotations, and
+ * checks that the tree is still a search tree over all the keys.
+ */
+template<class Tree>
+void test(std::string testName)
+{
+    FRCToken token;
+    lng numThreads = std::max((lng) 2, (lng) hardwareConcurrency());
+
+    Tree tree;
+    atm<lng> numRotations(0);
+    std::vector<std::thread> threads;
+    boost::barrier threadBarrier(numThreads + 1);
+
+    for(lng t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            FRCToken tkn;
+            lng rotations = 0;
+
+            threadBarrier.wait();
+            for(lng i = 0; i < numOps; ++i)
+            {
+                lng key = FastRNG::next(numKeys);
+                if(i % rotationsPerSearch == 0)
+                    rotations += tree.rotate(key);
+                else
+                    tree.find(key);
+            }
+            numRotations.fetch_add(rotations, orlx);
+        });
+    }
+
+    threadBarrier.wait();
+    auto tic = high_resolution_clock::now();
+    for(auto& t : threads)
+        t.join();
+    auto toc = high_resolution_clock::now();
+
+    ASSERT_EQ(tree.check(), (sz) numKeys);
+
+    double seconds = duration_cast<duration<double>>(toc - tic).count();
+    double throughput = (numOps * numThreads) / seconds;
+
+    std::cout << testName << ": " << numThreads << " threads, " << throughput
+              << " ops/s, " << numRotations.load(orlx) << " rotations" << std::endl;
+
+    std::ofstream ofile("./tree_rotation.txt", std::ios::app);
+    ofile << testName << "," << numThreads << "," << std::scientific
+          << std::setprecision(10) << throughput << std::endl;
+}
+
+} /* namespace tree_rotation */
+} /* namespace benchmarks */
+} /* namespace terrain */
+
+TEST(FRC_Tree_Rotation, lock)
+{
+    terrain::benchmarks::tree_rotation::test<terrain::benchmarks::tree_rotation::LockTree>("lock");
+}
+
+TEST(FRC_Tree_Rotation, multi_cas)
+{
+    terrain::benchmarks::tree_rotation::test<terrain::benchmarks::tree_rotation::CasTree>("multi_cas");
+}
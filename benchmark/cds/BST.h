@@ -227,6 +227,31 @@ public:
         }
     }
 
+    /**
+     * As find(), but walks raw pointers. The caller must keep the nodes from
+     * being reclaimed meanwhile, e.g. with an frc::ReadSection.
+     */
+    bool findUnprotected(Key key, Value& value)
+    {
+        Node* curr = rootParent->left.get();
+
+        for(;;)
+        {
+            if(curr == nullptr)
+                return false; //not found
+            if(key == curr->key) // found
+            {
+                value = curr->value;
+                return true;
+            }
+
+            if(key < curr->key)
+                curr = curr->left.get();
+            else if(key > curr->key)
+                curr = curr->right.get();
+        }
+    }
+
 public:
 
     BST()
@@ -751,6 +751,35 @@ public:
         return true;
     }
 
+    /**
+     * As find(), but walks raw pointers. The caller must keep the nodes from
+     * being reclaimed meanwhile, e.g. with an frc::ReadSection.
+     */
+    bool findUnprotected(
+        Key const& key,
+        Value& value)
+    {
+        readFence();
+
+        BaseNode* node = root.get();
+
+        // Traverse the tree down to a leaf.
+        while(!node->isLeaf)
+        {
+            IndexNode& indexNode = *(IndexNode*)node;
+            node = indexNode.values[indexNode.find(key)].get();
+        }
+
+        // Made it to a leaf.
+        LeafNode& leafNode = *(LeafNode*)node;
+        auto index = leafNode.find(key);
+        if(index < 0 || leafNode.keys[index] != key)
+            return false;
+
+        value = leafNode.values[index];
+        return true;
+    }
+
     void print()
     {
         doPrint(root, 0);
@@ -0,0 +1,193 @@
+/*
+ * File: HarrisList.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <frc/frc.h>
+
+namespace terrain
+{
+namespace cds
+{
+
+/**
+ * Lock-free ordered set (Harris, with Michael's eager unlinking) on FRC.
+ *
+ * A node is removed by first marking its own next edge, which logically
+ * deletes it and stops anything being linked after it, and then unlinking it
+ * from its predecessor. Any traversal that meets a marked node helps unlink it.
+ *
+ * Inserting an existing key leaves the stored value unchanged and returns false.
+ */
+template<class Key, class Value>
+class HarrisList
+{
+private:
+    struct Node;
+
+    using Edge = frc::MarkedAtomicPointer<Node>;
+    using Protected = frc::PrivatePointer<Node>;
+
+    struct Node
+    {
+        Key key;
+        Value value;
+        Edge next;
+
+        Node(Key k, Value v) :
+            key(k),
+            value(v)
+        {
+            ;
+        }
+    };
+
+public:
+
+    bool insert(Key key, Value value)
+    {
+        Protected prev;
+        Protected curr;
+        Protected node;
+
+        for(;;)
+        {
+            if(search(key, prev, curr))
+                return false; // already exists
+
+            if(node == nullptr)
+                node.make(key, value);
+            node->next.store(curr);
+
+            Node* expected = curr.get();
+            uintptr_t mark = 0;
+            if(prev->next.compare_exchange_strong(expected, mark, node, 0))
+                return true; // added
+        }
+    }
+
+    bool remove(Key key)
+    {
+        Protected prev;
+        Protected curr;
+        Protected next;
+
+        for(;;)
+        {
+            if(!search(key, prev, curr))
+                return false; // not found
+
+            uintptr_t mark = curr->next.load(next);
+            if(mark != 0)
+                continue; // lost to a concurrent remove, search again to help unlink
+
+            if(!curr->next.compare_exchange_mark(next.get(), mark, 1))
+                continue;
+
+            Node* expected = curr.get();
+            mark = 0;
+            if(!prev->next.compare_exchange_strong(expected, mark, next, 0))
+                search(key, prev, curr); // let the search unlink it instead
+            return true; // removed
+        }
+    }
+
+    bool find(Key key, Value& value)
+    {
+        Protected curr(head->next);
+        Protected next;
+
+        while(curr != nullptr && curr->key < key)
+        {
+            curr->next.load(next);
+            curr.swap(next);
+        }
+
+        if(curr == nullptr || curr->key != key || curr->next.isMarked())
+            return false; //not found
+
+        value = curr->value;
+        return true;
+    }
+
+public:
+
+    HarrisList()
+    {
+        head.make(Key(), Value());
+    }
+
+    sz count()
+    {
+        sz result = 0;
+        Protected curr(head->next);
+        Protected next;
+
+        while(curr != nullptr)
+        {
+            if(curr->next.load(next) == 0)
+                ++result;
+            curr.swap(next);
+        }
+
+        return result;
+    }
+
+private:
+
+    /**
+     * Positions prev and curr around key, so that curr is the first node with a key
+     * not less than key and prev is its unmarked predecessor, unlinking any marked
+     * nodes on the way. Returns whether curr holds key.
+     */
+    bool search(Key key, Protected& prev, Protected& curr)
+    {
+        Protected next;
+
+    retry:
+
+        prev = head;
+        prev->next.load(curr);
+
+        for(;;)
+        {
+            if(curr == nullptr)
+                return false;
+
+            if(curr->next.load(next) != 0)
+            {
+                // curr is logically deleted, unlink it
+                Node* expected = curr.get();
+                uintptr_t mark = 0;
+                if(!prev->next.compare_exchange_strong(expected, mark, next, 0))
+                    goto retry;
+
+                curr.swap(next);
+                continue;
+            }
+
+            if(!(curr->key < key))
+                return curr->key == key;
+
+            prev.swap(curr);
+            curr.swap(next);
+        }
+    }
+
+private:
+    frc::AtomicPointer<Node> head; //sentinel
+};
+
+} /* namespace cds */
+} /* namespace terrain */
@@ -120,6 +120,16 @@ public:
         ;
     }
 
+    /**
+     * Publishes the target of an expiring PrivatePointer. If that pointer made its
+     * target, the creation count is handed over rather than paired with a new increment.
+     */
+    template<class V>
+    AtomicPointer(PrivatePointer<V>&& that) noexcept
+    {
+        target.store(that.releaseCountedPointer(), orls);
+    }
+
     template<class ... Args>
     explicit AtomicPointer(Args&& ... args)
     {
@@ -225,6 +235,66 @@ public:
         return detail::getObjectHeader(get())->length();
     }
 
+public:
+
+    /**
+     * Replaces the stored pointer with desired if it currently equals expected.
+     *
+     * desired may be a PrivatePointer, a SharedPointer or nullptr. On success this
+     * pointer takes a reference to desired and releases its reference to the old value.
+     * On failure the reference taken for desired is released, and expected is re-pinned
+     * to the current value.
+     *
+     * Like std::atomic, the weak form may fail spuriously.
+     */
+    template<class D>
+    bool compare_exchange_weak(PrivatePointer<T>& expected, D const& desired) noexcept
+    {
+        return compareExchange(expected, countedPointer(desired), true);
+    }
+
+    template<class D>
+    bool compare_exchange_strong(PrivatePointer<T>& expected, D const& desired) noexcept
+    {
+        return compareExchange(expected, countedPointer(desired), false);
+    }
+
+    /**
+     * As above, but with an unprotected expected value. On failure, expected is set to
+     * the value observed, which must not be dereferenced unless otherwise protected.
+     */
+    template<class D>
+    bool compare_exchange_weak(T*& expected, D const& desired) noexcept
+    {
+        return compareExchange(expected, countedPointer(desired), true);
+    }
+
+    template<class D>
+    bool compare_exchange_strong(T*& expected, D const& desired) noexcept
+    {
+        return compareExchange(expected, countedPointer(desired), false);
+    }
+
+    /**
+     * RCU-style update: replaces the stored value with fn(current), retrying with the
+     * new current value whenever another thread changes the pointer first.
+     *
+     * fn takes a PrivatePointer<T> const& to the current value and returns the desired
+     * value (anything accepted by compare_exchange). It may be called more than once, so
+     * it should not have side effects beyond building the new value.
+     */
+    template<class Fn>
+    void update(Fn&& fn)
+    {
+        PrivatePointer<T> current(*this);
+        for(;;)
+        {
+            auto desired = fn((PrivatePointer<T> const&) current);
+            if(compare_exchange_weak(current, desired))
+                return;
+        }
+    }
+
 public:
 
     bool operator==(std::nullptr_t)const noexcept
@@ -275,6 +345,12 @@ public:
         return set(that.setCountedPointer());
     }
 
+    template<class V>
+    AtomicPointer& operator=(PrivatePointer<V>&& that)
+    {
+        return set(that.releaseCountedPointer());
+    }
+
     template<class V>
     AtomicPointer& operator=(SharedPointer<V> const& that)
     {
@@ -321,6 +397,49 @@ private:
         return *this;
     }
 
+    /**
+     * @param desired a pointer whose count has already been incremented for this pointer
+     */
+    bool compareExchange(T*& expected, T* desired, bool weak) noexcept
+    {
+        bool success = weak ?
+                       target.compare_exchange_weak(expected, desired, oarl, oacq) :
+                       target.compare_exchange_strong(expected, desired, oarl, oacq);
+
+        //success: release our reference to the old value; failure: undo the increment
+        detail::registerDecrement(success ? expected : desired);
+        return success;
+    }
+
+    bool compareExchange(PrivatePointer<T>& expected, T* desired, bool weak) noexcept
+    {
+        T* expectedPtr = expected.get();
+        if(compareExchange(expectedPtr, desired, weak))
+            return true;
+
+        //the observed value may already be unreachable, so pin whatever is current now
+        expected = *this;
+        return false;
+    }
+
+    template<class V>
+    static T* countedPointer(PrivatePointer<V> const& that) noexcept
+    {
+        return that.setCountedPointer();
+    }
+
+    template<class V>
+    static T* countedPointer(SharedPointer<V> const& that) noexcept
+    {
+        PrivatePointer<V> protect(that);
+        return protect.setCountedPointer();
+    }
+
+    static T* countedPointer(std::nullptr_t) noexcept
+    {
+        return nullptr;
+    }
+
 };
 
 
@@ -0,0 +1,293 @@
+/*
+ * File: MarkedAtomicPointer.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <util/atomic.h>
+#include <util/directives.h>
+
+#include "detail/FRCManager.h"
+
+namespace terrain
+{
+namespace frc
+{
+
+template<class T>
+class PrivatePointer;
+
+template<class T>
+class SharedPointer;
+
+/**
+ * Reference counted atomic pointer with Bits low-order mark bits, as used by
+ * lock-free lists and trees (Harris, Natarajan-Mittal) to flag an edge as
+ * logically deleted.
+ *
+ * The mark travels with the pointer in a single word, so compare_exchange
+ * compares and swaps both together. It is never seen by the collector: counts,
+ * pins and dereferences all use the unmarked pointer, so marking an edge neither
+ * changes the target's count nor stops a pin from protecting it.
+ *
+ * Objects directly follow their ObjectHeader, so Bits may not exceed the bits
+ * guaranteed to be zero by the header's alignment.
+ */
+template<class T, uint Bits = 1>
+class MarkedAtomicPointer
+{
+private:
+    template<class V>
+    friend class PrivatePointer;
+
+    static_assert(Bits > 0 && (1u << Bits) <= alignof(detail::ObjectHeader),
+                  "MarkedAtomicPointer: too many mark bits for the object alignment");
+
+public:
+    static constexpr uintptr_t markMask = ((uintptr_t) 1 << Bits) - 1;
+
+private:
+    atm<uintptr_t> target; //the stored pointer, with the mark in its low bits
+
+public:
+
+    MarkedAtomicPointer() noexcept
+    {
+        target.store(0, orls);
+    }
+
+    template<class V>
+    explicit MarkedAtomicPointer(PrivatePointer<V> const& that, uintptr_t mark = 0) noexcept
+    {
+        target.store(pack(that.setCountedPointer(), mark), orls);
+    }
+
+    MarkedAtomicPointer(MarkedAtomicPointer const&) = delete;
+
+    MarkedAtomicPointer(MarkedAtomicPointer&&) = delete;
+
+    MarkedAtomicPointer& operator=(MarkedAtomicPointer const&) = delete;
+
+    MarkedAtomicPointer& operator=(MarkedAtomicPointer&&) = delete;
+
+    ~MarkedAtomicPointer() noexcept
+    {
+        detail::registerDecrement(get(orlx));
+    }
+
+public:
+
+    template<class ... Args>
+    void make(Args&& ... args)
+    {
+        set(detail::makeNewObject<T>(1, std::forward<Args>(args) ...), 0);
+    }
+
+    /**
+     * Unconditionally replaces both the pointer and the mark.
+     */
+    template<class V>
+    void store(PrivatePointer<V> const& that, uintptr_t mark = 0) noexcept
+    {
+        set(that.setCountedPointer(), mark);
+    }
+
+    void store(std::nullptr_t, uintptr_t mark = 0) noexcept
+    {
+        set(nullptr, mark);
+    }
+
+    /**
+     * Pins the current target in into and returns the mark read with it.
+     */
+    uintptr_t load(PrivatePointer<T>& into) const noexcept
+    {
+        //see PrivatePointer::init() for the busySignal protocol
+        auto old = into.pin->load(orlx);
+        detail::PinSet::beginPin(into.pin);
+        auto value = target.load(oacq);
+        detail::PinSet::endPin(into.pin, unpack(value));
+        PrivatePointer<T>::drop(old);
+        return value & markMask;
+    }
+
+public:
+
+    T* get(std::memory_order mo = ocon) const noexcept
+    {
+        return unpack(target.load(mo));
+    }
+
+    /**
+     * Reads the pointer and its mark together.
+     */
+    T* get(uintptr_t& mark, std::memory_order mo = ocon) const noexcept
+    {
+        auto value = target.load(mo);
+        mark = value & markMask;
+        return unpack(value);
+    }
+
+    uintptr_t getMark(std::memory_order mo = ocon) const noexcept
+    {
+        return target.load(mo) & markMask;
+    }
+
+    bool isMarked(std::memory_order mo = ocon) const noexcept
+    {
+        return getMark(mo) != 0;
+    }
+
+    T& operator*() const noexcept
+    {
+        return *get();
+    }
+
+    T* operator->() const noexcept
+    {
+        return get();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return get() != nullptr;
+    }
+
+public:
+
+    /**
+     * Replaces the stored pointer and mark with desired and desiredMark if they
+     * currently equal expected and expectedMark.
+     *
+     * The reference counting handoff is that of AtomicPointer::compare_exchange.
+     * On failure expected and expectedMark are set to the values observed, and a
+     * PrivatePointer expected is re-pinned.
+     */
+    template<class D>
+    bool compare_exchange_weak(PrivatePointer<T>& expected, uintptr_t& expectedMark,
+                               D const& desired, uintptr_t desiredMark) noexcept
+    {
+        return compareExchange(expected, expectedMark, countedPointer(desired), desiredMark, true);
+    }
+
+    template<class D>
+    bool compare_exchange_strong(PrivatePointer<T>& expected, uintptr_t& expectedMark,
+                                 D const& desired, uintptr_t desiredMark) noexcept
+    {
+        return compareExchange(expected, expectedMark, countedPointer(desired), desiredMark, false);
+    }
+
+    template<class D>
+    bool compare_exchange_weak(T*& expected, uintptr_t& expectedMark,
+                               D const& desired, uintptr_t desiredMark) noexcept
+    {
+        return compareExchange(expected, expectedMark, countedPointer(desired), desiredMark, true);
+    }
+
+    template<class D>
+    bool compare_exchange_strong(T*& expected, uintptr_t& expectedMark,
+                                 D const& desired, uintptr_t desiredMark) noexcept
+    {
+        return compareExchange(expected, expectedMark, countedPointer(desired), desiredMark, false);
+    }
+
+    /**
+     * Changes only the mark, from expectedMark to desiredMark, provided the pointer
+     * is still expected. No counts change. On failure expectedMark is set to the
+     * observed mark.
+     */
+    bool compare_exchange_mark(T* expected, uintptr_t& expectedMark, uintptr_t desiredMark) noexcept
+    {
+        auto current = pack(expected, expectedMark);
+        if(target.compare_exchange_strong(current, pack(expected, desiredMark), oarl, oacq))
+            return true;
+
+        expectedMark = current & markMask;
+        return false;
+    }
+
+private:
+
+    static uintptr_t pack(T* ptr, uintptr_t mark) noexcept
+    {
+        assert(((uintptr_t) ptr & markMask) == 0);
+        assert((mark & ~markMask) == 0);
+        return (uintptr_t) ptr | mark;
+    }
+
+    static T* unpack(uintptr_t value) noexcept
+    {
+        return (T*)(value & ~markMask);
+    }
+
+    void set(T* ptr, uintptr_t mark) noexcept
+    {
+        auto old = target.exchange(pack(ptr, mark), oarl);
+        detail::registerDecrement(unpack(old));
+    }
+
+    /**
+     * @param desired a pointer whose count has already been incremented for this pointer
+     */
+    bool compareExchange(T*& expected, uintptr_t& expectedMark,
+                         T* desired, uintptr_t desiredMark, bool weak) noexcept
+    {
+        auto current = pack(expected, expectedMark);
+        auto value = pack(desired, desiredMark);
+        bool success = weak ?
+                       target.compare_exchange_weak(current, value, oarl, oacq) :
+                       target.compare_exchange_strong(current, value, oarl, oacq);
+
+        //success: release our reference to the old value; failure: undo the increment
+        detail::registerDecrement(success ? expected : desired);
+        if(!success)
+        {
+            expected = unpack(current);
+            expectedMark = current & markMask;
+        }
+        return success;
+    }
+
+    bool compareExchange(PrivatePointer<T>& expected, uintptr_t& expectedMark,
+                         T* desired, uintptr_t desiredMark, bool weak) noexcept
+    {
+        T* expectedPtr = expected.get();
+        if(compareExchange(expectedPtr, expectedMark, desired, desiredMark, weak))
+            return true;
+
+        //the observed value may already be unreachable, so pin whatever is current now
+        expectedMark = load(expected);
+        return false;
+    }
+
+    template<class V>
+    static T* countedPointer(PrivatePointer<V> const& that) noexcept
+    {
+        return that.setCountedPointer();
+    }
+
+    template<class V>
+    static T* countedPointer(SharedPointer<V> const& that) noexcept
+    {
+        PrivatePointer<V> protect(that);
+        return protect.setCountedPointer();
+    }
+
+    static T* countedPointer(std::nullptr_t) noexcept
+    {
+        return nullptr;
+    }
+
+};
+
+} /* namespace frc */
+} /* namespace terrain */
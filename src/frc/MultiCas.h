@@ -0,0 +1,257 @@
+/*
+ * File: MultiCas.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+#include <util/atomic.h>
+#include <util/directives.h>
+#include <util/Exception.h>
+
+#include "detail/FRCManager.h"
+#include "detail/MultiCasDescriptor.h"
+
+namespace terrain
+{
+namespace frc
+{
+
+template<class T>
+class PrivatePointer;
+
+template<class T>
+class CasPointer;
+
+class MultiCas;
+
+/**
+ * Reference counted atomic pointer that can take part in a MultiCas.
+ *
+ * While a multi-word CAS is in flight the slot may hold one of its descriptors
+ * instead of a plain pointer. Every access helps such a descriptor to
+ * completion first, so reads always return a committed value; for this reason
+ * the target is only reachable through a PrivatePointer (see load()).
+ */
+template<class T>
+class CasPointer
+{
+private:
+    template<class V>
+    friend class PrivatePointer;
+
+    friend class MultiCas;
+
+    using Descriptor = detail::MultiCasDescriptor;
+
+private:
+    atm<uintptr_t> word; //a plain pointer, or a tagged descriptor
+
+public:
+
+    CasPointer() noexcept
+    {
+        word.store(0, orls);
+    }
+
+    template<class V>
+    explicit CasPointer(PrivatePointer<V> const& that) noexcept
+    {
+        word.store((uintptr_t) that.setCountedPointer(), orls);
+    }
+
+    CasPointer(CasPointer const&) = delete;
+
+    CasPointer(CasPointer&&) = delete;
+
+    CasPointer& operator=(CasPointer const&) = delete;
+
+    CasPointer& operator=(CasPointer&&) = delete;
+
+    /**
+     * No operation may be in flight on this slot.
+     */
+    ~CasPointer() noexcept
+    {
+        auto value = word.load(orlx);
+        assert(Descriptor::isPlain(value));
+        detail::registerDecrement((T*) value);
+    }
+
+public:
+
+    template<class ... Args>
+    void make(Args&& ... args)
+    {
+        set(detail::makeNewObject<T>(1, std::forward<Args>(args) ...));
+    }
+
+    template<class V>
+    void store(PrivatePointer<V> const& that)
+    {
+        set(that.setCountedPointer());
+    }
+
+    void store(std::nullptr_t)
+    {
+        set(nullptr);
+    }
+
+    /**
+     * Returns the current committed target, unprotected: as with AtomicPointer::get(),
+     * the caller must ensure it stays reachable.
+     */
+    T* get() const
+    {
+        PrivatePointer<T> current;
+        load(current);
+        return current.get();
+    }
+
+    /**
+     * Pins the current committed target in into.
+     */
+    void load(PrivatePointer<T>& into) const
+    {
+        auto old = into.pin->load(orlx);
+        for(;;)
+        {
+            auto value = Descriptor::loadPinned(&word, into.pin);
+            if(Descriptor::isPlain(value))
+                break;
+
+            //the descriptor is pinned in into until it is overwritten
+            Descriptor::helpWord(value);
+        }
+        PrivatePointer<T>::drop(old);
+    }
+
+    /**
+     * Single-slot compare and swap, with the reference counting of
+     * AtomicPointer::compare_exchange_strong. On failure expected is re-pinned
+     * to the current target.
+     */
+    template<class V>
+    bool compare_exchange_strong(PrivatePointer<T>& expected, PrivatePointer<V> const& desired)
+    {
+        return compareExchange(expected, desired.setCountedPointer());
+    }
+
+    bool compare_exchange_strong(PrivatePointer<T>& expected, std::nullptr_t)
+    {
+        return compareExchange(expected, nullptr);
+    }
+
+private:
+
+    void set(T* ptr)
+    {
+        PrivatePointer<T> current;
+        load(current);
+        while(!compareExchange(current, ptr, false))
+            ;
+    }
+
+    /**
+     * @param desired a pointer whose count has already been incremented for this pointer
+     */
+    bool compareExchange(PrivatePointer<T>& expected, T* desired, bool undoOnFailure = true)
+    {
+        for(;;)
+        {
+            auto current = (uintptr_t) expected.get();
+            if(word.compare_exchange_strong(current, (uintptr_t) desired, oarl, oacq))
+            {
+                detail::registerDecrement(expected.get());
+                return true;
+            }
+
+            //a descriptor may still commit expected, so look at the committed value
+            PrivatePointer<T> observed;
+            load(observed);
+            if(observed.get() != expected.get())
+            {
+                if(undoOnFailure)
+                    detail::registerDecrement(desired);
+                expected.swap(observed);
+                return false;
+            }
+        }
+    }
+};
+
+/**
+ * Atomically replaces the targets of several CasPointers, provided each still
+ * holds its expected target. Lock-free: conflicting operations help each
+ * other to completion, and descriptors are reclaimed by FRC.
+ *
+ * Usage: add() up to FRCConstants::maxMultiCasEntries distinct slots, then
+ * execute(). Desired values must stay pinned (e.g. by the PrivatePointers
+ * passed in) until execute() returns.
+ */
+class MultiCas
+{
+public:
+
+    MultiCas() noexcept :
+        numEntries(0)
+    {
+        ;
+    }
+
+    template<class T, class V>
+    MultiCas& add(CasPointer<T>& slot, T* expected, PrivatePointer<V> const& desired)
+    {
+        desired.share(); //the descriptor counts desired from elsewhere
+        return addEntry(&slot.word, expected, static_cast<T*>(desired.get()));
+    }
+
+    template<class T>
+    MultiCas& add(CasPointer<T>& slot, T* expected, std::nullptr_t)
+    {
+        return addEntry(&slot.word, expected, nullptr);
+    }
+
+    template<class T, class V>
+    MultiCas& add(CasPointer<T>& slot, PrivatePointer<T> const& expected, V const& desired)
+    {
+        return add(slot, expected.get(), desired);
+    }
+
+    /**
+     * Returns true if every slot was updated, false if none was.
+     */
+    bool execute()
+    {
+        PrivatePointer<detail::MultiCasDescriptor> descriptor(
+            (detail::MultiCasEntry const*) entries, numEntries);
+        descriptor.share(); //slots and helpers count it
+        return descriptor->help();
+    }
+
+private:
+
+    MultiCas& addEntry(atm<uintptr_t>* slot, void* expected, void* desired)
+    {
+        if(numEntries == detail::FRCConstants::maxMultiCasEntries)
+            throw Exception("MultiCas: more than ", numEntries, " slots");
+
+        entries[numEntries++] = {slot, expected, desired};
+        return *this;
+    }
+
+private:
+    detail::MultiCasEntry entries[detail::FRCConstants::maxMultiCasEntries];
+    sz numEntries;
+};
+
+} /* namespace frc */
+} /* namespace terrain */
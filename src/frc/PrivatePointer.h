@@ -32,6 +32,14 @@ class SharedPointer;
 template<class T>
 class AtomicPointer;
 
+template<class T, uint Bits>
+class MarkedAtomicPointer;
+
+template<class T>
+class CasPointer;
+
+class MultiCas;
+
 /**
  * Skinny and fast protected set pointer. Good for most applications.
  *
@@ -42,10 +50,9 @@ class AtomicPointer;
  * when traversing data structures. This prevents the objects being
  * read from begin reclaimed out from under the reader.
  *
- * There is a limit (currently 1024) to the number of pins allowed at one
- * time for a particular thread. For performance reasons,
- * there is no safeguard in place to prevent over-allocations of pins beyond
- * this limit. Typical applications will only pin a handful of things.
+ * Each PrivatePointer holds one of its thread's pins. A thread's pin set
+ * grows by blocks (see FRCConstants::pinBlockSize) as needed, though typical
+ * applications will only pin a handful of things.
  *
  * T is the type of the object being pointed to.
  */
@@ -65,6 +72,16 @@ private:
     friend
     class AtomicPointer;
 
+    template<class V, uint Bits>
+    friend
+    class MarkedAtomicPointer;
+
+    template<class V>
+    friend
+    class CasPointer;
+
+    friend class MultiCas;
+
 private:
 
     /**
@@ -87,7 +104,8 @@ public:
     PrivatePointer(PrivatePointer&& that) noexcept :
         pin(detail::PinSet::acquire())
     {
-        std::swap(*this, that);
+        pin->store(nullptr, orls);
+        swap(that);
     }
 
     PrivatePointer(PrivatePointer const& that) noexcept :
@@ -138,18 +156,35 @@ public:
         ;
     }
 
+    /**
+     * Pins the target of that, ignoring its mark.
+     */
+    template<class V, uint Bits>
+    PrivatePointer(MarkedAtomicPointer<V, Bits> const& that) noexcept :
+        pin(detail::PinSet::acquire())
+    {
+        init(that);
+    }
+
+    template<class V, uint Bits>
+    PrivatePointer(MarkedAtomicPointer<V, Bits>& that) noexcept :
+        PrivatePointer((MarkedAtomicPointer<V, Bits> const&) that)
+    {
+        ;
+    }
+
     template<class ... Args>
     explicit PrivatePointer(Args&& ... args) :
         pin(detail::PinSet::acquire())
     {
-        make<T>(std::forward<Args>(args) ...);
+        makeType<T>(std::forward<Args>(args) ...);
     }
 
     template<class V, class ... Args>
     explicit PrivatePointer(Args&& ... args) :
         pin(detail::PinSet::acquire())
     {
-        make<V>(std::forward<Args>(args) ...);
+        makeType<V>(std::forward<Args>(args) ...);
     }
 
     template<class ... Args>
@@ -174,6 +209,7 @@ public:
 
     ~PrivatePointer() noexcept
     {
+        drop(pin->load(orlx));
         while(detail::ThreadData::isScanning())
             ;
         detail::PinSet::release(pin);
@@ -199,7 +235,7 @@ public:
 
     T* get() const noexcept
     {
-        return reinterpret_cast<T*>(pin->load(orlx));
+        return untag(pin->load(orlx));
     }
 
     sz length() const noexcept
@@ -211,7 +247,7 @@ public:
 
     PrivatePointer& operator=(std::nullptr_t const&)noexcept
     {
-        return set((T*) nullptr);
+        return set(nullptr);
     }
 
     template<class V>
@@ -250,6 +286,12 @@ public:
         return set(that);
     }
 
+    template<class V, uint Bits>
+    PrivatePointer& operator=(MarkedAtomicPointer<V, Bits> const& that) noexcept
+    {
+        return set(that);
+    }
+
 public:
 
     bool operator==(std::nullptr_t) const noexcept
@@ -315,7 +357,9 @@ private:
 
     PrivatePointer& set(std::nullptr_t) noexcept
     {
+        auto old = pin->load(orlx);
         pin->store(nullptr, orlx);
+        drop(old);
         return *this;
     }
 
@@ -329,17 +373,21 @@ private:
     template<class V>
     PrivatePointer& copyFrom(PrivatePointer<V> const& that) noexcept
     {
+        that.share();
+        auto old = pin->load(orlx);
         auto ptr = that.get();
         detail::registerIncrement(ptr);
         pin->store(ptr, orls);
         detail::registerDecrement(ptr);
+        drop(old);
         return *this;
     }
 
     template<class V>
     PrivatePointer& init(PrivatePointer<V> const& that) noexcept
     {
-        pin->store(that.get(), orls);
+        that.share();
+        pin->store(static_cast<T*>(that.get()), orls);
         return *this;
     }
 
@@ -347,7 +395,10 @@ private:
     PrivatePointer& set(PrivatePointer<V> const& that) noexcept
     {
         //detail::ThreadData::waitForScan();
-        return init(that);
+        auto old = pin->load(orlx);
+        init(that);
+        drop(old);
+        return *this;
     }
 
 
@@ -362,9 +413,9 @@ private:
          * being added to the pin set.
          */
 
-        pin->store((void*) detail::FRCConstants::busySignal, orls);
+        detail::PinSet::beginPin(pin);
         auto ptr = that.get(oacq);
-        pin->store(ptr, orls);
+        detail::PinSet::endPin(pin, ptr);
         return *this;
     }
 
@@ -372,31 +423,94 @@ private:
     PrivatePointer& set(V const& that) noexcept
     {
         //detail::ThreadData::waitForScan();
-        return init(that);
+        auto old = pin->load(orlx); //that may be reachable only through old
+        init(that);
+        drop(old);
+        return *this;
     }
 
     /**
      * Strategies with the first increment:
      * + Create object with count = 1
      *  - Must register a decrement or put in ZCT to check if set to a shared ptr
-     * + Create object with count = 0 **using this one**
+     * + Create object with count = 0
      *  - Must register an increment when set to a shared ptr
-     * + Create object with count = 1 and decrement if not set
+     * + Create object with count = 1 and decrement if not set **using this one**
      *  + minimizes work done in the common case
      *  - must keep additional state information about private vs shared status
+     *
+     * The status is kept in the pin, tagged with ownedPinTag, for as long as the
+     * object has not been shared. Until then nothing else can reach it, so the
+     * scanner skips the pin, and letting go of the object destroys it on the
+     * spot instead of logging a decrement: speculative allocations that are never
+     * published cost no more than a malloc and a free.
      */
     void doEmplace(T* ptr) noexcept
     {
-        pin->store(ptr, orls);
-        detail::registerDecrement(ptr);
+        auto old = pin->load(orlx);
+        pin->store(tag(ptr), orls);
+        drop(old);
+    }
+
+    /**
+     * Ends the unshared status before the target becomes reachable elsewhere.
+     * The creation count goes to the log, and the target stays pinned.
+     */
+    void share() const noexcept
+    {
+        auto value = pin->load(orlx);
+        if(!isTagged(value))
+            return;
+
+        pin->store(untag(value), orls);
+        detail::registerDecrement(untag(value));
     }
 
     T* setCountedPointer() const noexcept
     {
+        share();
         T* ptr = get();
         detail::registerIncrement(ptr);
         return ptr;
     }
+
+    /**
+     * As setCountedPointer(), but hands over the creation count instead of taking
+     * a new one when the target has not been shared. The target stays pinned either way.
+     */
+    T* releaseCountedPointer() noexcept
+    {
+        auto value = pin->load(orlx);
+        if(!isTagged(value))
+            return setCountedPointer();
+
+        pin->store(untag(value), orls);
+        return untag(value);
+    }
+
+    /**
+     * Lets go of a value this pointer's pin held.
+     */
+    static void drop(void* value) noexcept
+    {
+        if(isTagged(value))
+            detail::getObjectHeader(untag(value))->destroy();
+    }
+
+    static bool isTagged(void* value) noexcept
+    {
+        return ((uintptr_t) value & detail::FRCConstants::ownedPinTag) != 0;
+    }
+
+    static void* tag(T* ptr) noexcept
+    {
+        return (void*)((uintptr_t) ptr | detail::FRCConstants::ownedPinTag);
+    }
+
+    static T* untag(void* value) noexcept
+    {
+        return (T*)((uintptr_t) value & ~(uintptr_t) detail::FRCConstants::ownedPinTag);
+    }
 };
 
 } /* namespace frc */
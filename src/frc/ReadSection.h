@@ -0,0 +1,63 @@
+/*
+ * File: ReadSection.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "detail/FRCManager.h"
+
+namespace terrain
+{
+namespace frc
+{
+
+/**
+ * RCU-style read section. While one is on the stack, objects read through
+ * raw pointers (e.g. AtomicPointer::get()) are not reclaimed, so traversals
+ * can skip pinning each node they visit. The thread announces itself once on
+ * entry instead of once per PrivatePointer.
+ *
+ * A read section holds up every collection epoch, so keep it short and
+ * bounded: one lookup or traversal, not a loop over many. Inside a section
+ * the thread does not help collect, and must not call FRCManager::collect()
+ * or unregister. Sections nest, and PrivatePointers work as usual inside them.
+ */
+class ReadSection
+{
+public:
+
+    ReadSection() noexcept :
+        td(detail::threadData)
+    {
+        td->enterReadSection();
+    }
+
+    ReadSection(ReadSection const&) = delete;
+
+    ReadSection(ReadSection&&) = delete;
+
+    ReadSection& operator=(ReadSection const&) = delete;
+
+    ReadSection& operator=(ReadSection&&) = delete;
+
+    ~ReadSection() noexcept
+    {
+        td->exitReadSection();
+    }
+
+private:
+    detail::ThreadData* td;
+};
+
+} /* namespace frc */
+} /* namespace terrain */
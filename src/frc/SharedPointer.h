@@ -124,6 +124,16 @@ public:
         ;
     }
 
+    /**
+     * Publishes the target of an expiring PrivatePointer. If that pointer made its
+     * target, the creation count is handed over rather than paired with a new increment.
+     */
+    template<class V>
+    SharedPointer(PrivatePointer<V>&& that) noexcept
+    {
+        target.store(that.releaseCountedPointer(), orls);
+    }
+
     template<class ... Args>
     explicit SharedPointer(Args&& ... args)
     {
@@ -281,6 +291,12 @@ public:
         return set(that.setCountedPointer());
     }
 
+    template<class V>
+    SharedPointer& operator=(PrivatePointer<V>&& that)
+    {
+        return set(that.releaseCountedPointer());
+    }
+
     SharedPointer& operator=(SharedPointer const& that) noexcept
     {
         T* ptr = that.get(orlx);
@@ -14,12 +14,11 @@
 
 #pragma once
 
-#include <vector>
-#include <typeinfo>
-#include <typeindex>
-#include <unordered_map>
 #include <cassert>
+#include <type_traits>
 #include <util/types.h>
+#include <util/atomic.h>
+#include <util/Exception.h>
 
 namespace terrain
 {
@@ -37,83 +36,141 @@ static void destroyObject(ObjectHeader* header);
 template<class T>
 static void destroyArray(ObjectHeader* objectHeader);
 
-// We use a function to retrieve the destructor map to avoid static initialization ordering issues
-DestructorMap& getDestructorMap(); //defined in FRCManager.cpp
+template<class T>
+static void destroyObjects(ObjectHeader** headers, sz n);
+
+template<class T>
+static void destroyArrays(ObjectHeader** objectHeaders, sz n);
+
+/**
+ * Holds the type code of T, or zero if T has not been registered yet.
+ * This is constant-initialized, so it is valid during static initialization
+ * and reading it never involves a guard variable.
+ */
+template<class T>
+struct TypeCode
+{
+    static atm<uint> code;
+};
+
+template<class T>
+atm<uint> TypeCode<T>::code(0);
 
+/**
+ * Maps type codes to destructor thunks.
+ *
+ * Each type is assigned a pair of codes (object, array) on first use, and its
+ * thunks are written into flat static tables, so calling a destructor is a
+ * single indexed load. Registration is lock-free: racing threads each reserve
+ * a pair of codes, and the first to publish into TypeCode<T> wins.
+ */
 class DestructorMap
 {
 public:
     using Destructor = void(*)(ObjectHeader* header);
+    using BatchDestructor = void(*)(ObjectHeader** headers, sz n);
 
-private:
+    static constexpr sz maxTypeCodes = sz(1) << 16;
 
-    static constexpr sz initialCapacity = 8192;
+    /* Set in the type codes of trivially destructible types. Objects with this
+     * flag are freed directly by the sweep, without calling a destructor thunk.
+     */
+    static constexpr uint trivialTypeFlag = uint(1) << 31;
 
 public:
 
-    DestructorMap()
+    template<class T>
+    static uint getTypeCode()
     {
-        destructors.reserve(initialCapacity);
+        auto typeCode = TypeCode<T>::code.load(oacq);
+        if(typeCode != 0)
+            return typeCode;
+
+        return registerType<T>();
     }
 
-    ~DestructorMap()
+    template<class T>
+    static uint getArrayTypeCode()
     {
-        ;
+        return getTypeCode<T>() + 1;
     }
 
-    template<class T>
-    static uint getTypeCode()
+    static bool isTrivial(uint typeCode) noexcept
     {
-        //TODO: investigate better ways of doing this.
-        static auto const typeCode = getDestructorMap().registerType<T>();
-        return typeCode;
+        return (typeCode & trivialTypeFlag) != 0;
     }
 
-    template<class T>
-    static uint getArrayTypeCode()
+    /**
+     * @return sizeof(T) for the objects (or array elements) of the given type code
+     */
+    static sz getTypeSize(uint typeCode) noexcept
     {
-        //TODO: investigate better ways of doing this.
-        static auto const typeCode = getTypeCode<T>() + 1;
-        return typeCode;
+        return typeSizes[getIndex(typeCode)];
     }
 
     static void callDestructor(ObjectHeader* header, uint typeCode)
     {
-        static auto& dm = getDestructorMap();
-
-        assert(typeCode < dm.destructors.size());
-        auto destructor = dm.destructors[typeCode];
+        auto destructor = destructors[getIndex(typeCode)];
         assert(destructor != nullptr);
 
         destructor(header);
     }
 
+    /**
+     * Destroys n objects that all share the given type code.
+     */
+    static void callDestructors(ObjectHeader** headers, sz n, uint typeCode)
+    {
+        auto destructor = batchDestructors[getIndex(typeCode)];
+        assert(destructor != nullptr);
+
+        destructor(headers, n);
+    }
+
 private:
 
+    static sz getIndex(uint typeCode) noexcept
+    {
+        auto index = typeCode & ~trivialTypeFlag;
+        assert(index < maxTypeCodes);
+        return index;
+    }
+
     template<class T>
-    uint registerType()
+    static uint registerType()
     {
         static_assert(
             sizeof(T*) == sizeof(void*),
             "Type pointer and void pointer must be the same size.");
 
-        std::type_index typeIndex(typeid(T));
-        auto iter = typeIDToTypeCodeMap.find(typeIndex);
-        if(iter != typeIDToTypeCodeMap.end())
-            return iter->second; //hit
+        //objects get even codes, arrays the following odd code; zero is reserved
+        uint typeCode = nextTypeCode.fetch_add(2, orlx);
+        if(typeCode >= maxTypeCodes)
+            throw Exception("DestructorMap: more than ", maxTypeCodes / 2, " types registered");
+
+        destructors[typeCode] = &destroyObject<T>;
+        destructors[typeCode + 1] = &destroyArray<T>;
+        batchDestructors[typeCode] = &destroyObjects<T>;
+        batchDestructors[typeCode + 1] = &destroyArrays<T>;
+        typeSizes[typeCode] = sizeof(T);
+        typeSizes[typeCode + 1] = sizeof(T);
+
+        if(std::is_trivially_destructible<T>::value)
+            typeCode |= trivialTypeFlag;
 
-        //miss
-        uint typeCode = (uint)destructors.size();
-        typeIDToTypeCodeMap.insert(iter, {typeIndex, typeCode});
-        destructors.emplace_back(&destroyObject<T>);
-        destructors.emplace_back(&destroyArray<T>);
+        uint expected = 0;
+        if(!TypeCode<T>::code.compare_exchange_strong(expected, typeCode, oarl, oacq))
+            return expected; //another thread registered T first; our codes go unused
 
         return typeCode;
     }
 
 private:
-    std::vector<Destructor> destructors;
-    std::unordered_map<std::type_index, uint> typeIDToTypeCodeMap; //TODO: optimize
+    //these are defined in FRCManager.cpp
+    static atm<uint> nextTypeCode;
+    static Destructor destructors[maxTypeCodes];
+    static BatchDestructor batchDestructors[maxTypeCodes]; //indexed like destructors
+    static sz typeSizes[maxTypeCodes];
 };
 
 }
@@ -0,0 +1,82 @@
+/*
+ * File: FRCConstants.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FRCConstants.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+//out-of-line definitions, for constants passed by reference (e.g. to std::min)
+constexpr sz FRCConstants::pinBlockSize;
+constexpr sz FRCConstants::logBlockSize;
+constexpr sz FRCConstants::logSize;
+constexpr sz FRCConstants::logSegmentSize;
+constexpr sz FRCConstants::maxPooledLogSegments;
+constexpr sz FRCConstants::decrementCombiningCacheSize;
+constexpr sz FRCConstants::sweepPrefetchDistance;
+constexpr sz FRCConstants::baseHelpInterval;
+constexpr sz FRCConstants::maxLogSizeBeforeHelpIntervalReduction;
+constexpr sz FRCConstants::maxLogSizeBeforeBlockingHelpCall;
+constexpr bool FRCConstants::enableOverflowSpill;
+constexpr float FRCConstants::helpIntervalReductionConstant;
+constexpr sz FRCConstants::numHelpAttemptsBeforeBlocking;
+constexpr sz FRCConstants::helpBudgetTicks;
+constexpr sz FRCConstants::sweepChunkSize;
+constexpr sz FRCConstants::helpWaitMicroseconds;
+constexpr sz FRCConstants::taskStallTicks;
+constexpr sz FRCConstants::stallWaitMicroseconds;
+constexpr sz FRCConstants::numTaskSlots;
+constexpr sz FRCConstants::numTaskSlotProbes;
+constexpr sz FRCConstants::idleCaptureTicks;
+constexpr sz FRCConstants::memoryPressureHelpInterval;
+constexpr sz FRCConstants::numEmergencyCollectionSteps;
+constexpr sz FRCConstants::maxHelpInterval;
+constexpr HelpPolicyType FRCConstants::defaultHelpPolicy;
+constexpr sz FRCConstants::numHelpSizeSamples;
+constexpr sz FRCConstants::helpTargetBytesInFlight;
+constexpr float FRCConstants::helpProportionalGain;
+constexpr float FRCConstants::helpIntegralGain;
+constexpr float FRCConstants::helpDerivativeGain;
+constexpr float FRCConstants::maxHelpIntegral;
+constexpr float FRCConstants::helpBlockingOutput;
+constexpr sz FRCConstants::helpLatencyBudgetNanoseconds;
+constexpr sz FRCConstants::numTryHelpCallsOnUnregister;
+constexpr sz FRCConstants::maxPooledThreadData;
+constexpr sz FRCConstants::numCollectorSpinsBeforeSleep;
+constexpr sz FRCConstants::collectorSleepMicroseconds;
+constexpr bool FRCConstants::enablePoolAllocator;
+constexpr sz FRCConstants::maxPooledAllocationSize;
+constexpr sz FRCConstants::numPoolSizeClasses;
+constexpr sz FRCConstants::poolChunkSize;
+constexpr sz FRCConstants::numPoolRemoteBatches;
+constexpr sz FRCConstants::poolRemoteBatchSize;
+constexpr bool FRCConstants::enableMemoryBudget;
+constexpr sz FRCConstants::memoryBudgetFlushBytes;
+constexpr sz FRCConstants::maxMultiCasEntries;
+constexpr bool FRCConstants::enableSemiDeferredDecrements;
+constexpr bool FRCConstants::enableCheckedDecrements;
+constexpr bool FRCConstants::enableAsymmetricPinFences;
+constexpr sz FRCConstants::busySignal;
+constexpr sz FRCConstants::ownedPinTag;
+constexpr sz FRCConstants::freePinTag;
+constexpr byte FRCConstants::scan;
+constexpr byte FRCConstants::sweep;
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
@@ -16,6 +16,11 @@
 
 #include <util/util.h>
 
+//build with -DFRC_ASYMMETRIC_PIN_FENCES=1 to enable FRCConstants::enableAsymmetricPinFences
+#ifndef FRC_ASYMMETRIC_PIN_FENCES
+#define FRC_ASYMMETRIC_PIN_FENCES 0
+#endif
+
 namespace terrain
 {
 namespace frc
@@ -23,29 +28,85 @@ namespace frc
 namespace detail
 {
 
+enum class HelpPolicyType : byte
+{
+    logSize, //see LogSizeHelpPolicy
+    bytesInFlight, //see BytesInFlightHelpPolicy
+    latency //see LatencyHelpPolicy
+};
+
+/**
+ * Each constant also has a definition in FRCConstants.cpp, so that passing
+ * one by reference links in unoptimized builds.
+ */
 class FRCConstants
 {
 public:
-    static constexpr sz pinSetSize = 128;
-    static constexpr sz protectedBlockSize = 128; //must be pinSetSize
+    static constexpr sz pinBlockSize = 128; //pin sets grow by blocks of this many pins
 
     static constexpr sz logBlockSize = 256;
-    static constexpr sz logSize = sz(1) << 21; //16 MB
-    static constexpr sz logBufferSize = sz(1) << 22; //must be a power of two (2MB)
-    static constexpr sz logMask = logBufferSize - 1;
+    static constexpr sz logSize = sz(1) << 21; //max outstanding decrements per thread (16 MB)
+    static constexpr sz logSegmentSize = sz(1) << 12; //must be a power of two (32 KB)
+    static constexpr sz maxPooledLogSegments = 256; //segments kept for reuse (8 MB)
+
+    static constexpr sz decrementCombiningCacheSize = 32; //must be a power of two
+    static constexpr sz sweepPrefetchDistance = 8; //log entries fetched ahead of the sweep
 
     static constexpr sz baseHelpInterval = 64;
     static constexpr sz maxLogSizeBeforeHelpIntervalReduction = logSize / 2; //logBlockSize * 16;
     static constexpr sz maxLogSizeBeforeBlockingHelpCall = logSize - 32 * logBlockSize;
+    static constexpr bool enableOverflowSpill = true; //false: block on help past maxLogSizeBeforeBlockingHelpCall
     static constexpr float helpIntervalReductionConstant = (logSize -
             maxLogSizeBeforeHelpIntervalReduction) / baseHelpInterval;
     static constexpr sz numHelpAttemptsBeforeBlocking = 64;
+    static constexpr sz helpBudgetTicks = 200000; //per mutator help call, in TSC ticks; 0: unbounded
+    static constexpr sz sweepChunkSize = 32; //decrements applied between budget checks
+    static constexpr sz helpWaitMicroseconds = 50; //between budget checks while blocked on help
+    static constexpr sz taskStallTicks = 4000000; //without progress, before helpers take over a sweep block; 0: never
+    static constexpr sz stallWaitMicroseconds = 1000; //between looks for stalled blocks while blocked on help
+    static constexpr sz numTaskSlots = 64; //sweep blocks in progress that can be taken over
+    static constexpr sz numTaskSlotProbes = 4; //slots a helper tries before working unpublished
+    static constexpr sz idleCaptureTicks = 2000000; //without a help call, before helpers publish a thread's log; 0: never
+    static constexpr sz memoryPressureHelpInterval = baseHelpInterval / 8;
+    static constexpr sz numEmergencyCollectionSteps = 16; //at most, per emergency collection
+    static constexpr sz maxHelpInterval = baseHelpInterval * 16;
+
+    static constexpr HelpPolicyType defaultHelpPolicy = HelpPolicyType::logSize;
+    static constexpr sz numHelpSizeSamples = 4; //recent log entries sized per help call
+    static constexpr sz helpTargetBytesInFlight = sz(1) << 24; //per thread (16 MB)
+    static constexpr float helpProportionalGain = 2.0f;
+    static constexpr float helpIntegralGain = 0.1f;
+    static constexpr float helpDerivativeGain = 1.0f;
+    static constexpr float maxHelpIntegral = 32.0f;
+    static constexpr float helpBlockingOutput = 8.0f;
+    static constexpr sz helpLatencyBudgetNanoseconds = 50; //inline help time per logged decrement
     static constexpr sz numTryHelpCallsOnUnregister = 1024;
+    static constexpr sz maxPooledThreadData = 64; //drained ThreadData kept for reuse
+    static constexpr sz numCollectorSpinsBeforeSleep = 1024;
+    static constexpr sz collectorSleepMicroseconds = 50;
+
+    static constexpr bool enablePoolAllocator = true; //false: allocate FRC objects with malloc/free
+    static constexpr sz maxPooledAllocationSize = 512; //larger allocations use malloc
+    static constexpr sz numPoolSizeClasses = maxPooledAllocationSize / 16;
+    static constexpr sz poolChunkSize = sz(1) << 16; //must be a power of two
+    static constexpr sz numPoolRemoteBatches = 16; //must be a power of two
+    static constexpr sz poolRemoteBatchSize = 64;
+
+    static constexpr bool enableMemoryBudget = true; //false: don't count FRC heap bytes (see MemoryBudget)
+    static constexpr sz memoryBudgetFlushBytes = sz(1) << 18; //per-thread counting slack (256 KB)
+
+    static constexpr sz maxMultiCasEntries = 8; //slots updated by one MultiCas
 
     static constexpr bool enableSemiDeferredDecrements = false;
     static constexpr bool enableCheckedDecrements = false;
 
+    /* Linux only: scanners serialize mutators with membarrier() before reading
+     * pins, so the pin handshake (see PinSet::beginPin()) needs no ordering. */
+    static constexpr bool enableAsymmetricPinFences = FRC_ASYMMETRIC_PIN_FENCES;
+
     static constexpr sz busySignal = 1;
+    static constexpr sz ownedPinTag = 2; //see PrivatePointer::doEmplace()
+    static constexpr sz freePinTag = 1; //see PinSet
 
     static constexpr byte scan = 0;
     static constexpr byte sweep = 1;
@@ -27,11 +27,24 @@ namespace frc
 namespace detail
 {
 
-DestructorMap& getDestructorMap()
+//constant-initialized, so they are usable before any dynamic initialization
+atm<uint> DestructorMap::nextTypeCode(2);
+DestructorMap::Destructor DestructorMap::destructors[DestructorMap::maxTypeCodes];
+DestructorMap::BatchDestructor DestructorMap::batchDestructors[DestructorMap::maxTypeCodes];
+sz DestructorMap::typeSizes[DestructorMap::maxTypeCodes];
+
+LogSegmentPool& getLogSegmentPool()
+{
+    static LogSegmentPool s_logSegmentPool;
+
+    return s_logSegmentPool;
+}
+
+PoolAllocator& getPoolAllocator()
 {
-    static DestructorMap s_destructorMap;
+    static PoolAllocator s_poolAllocator;
 
-    return s_destructorMap;
+    return s_poolAllocator;
 }
 
 //this is left uninitialized for performance reasons
@@ -49,14 +62,19 @@ FRCManager& getFRCManager()
 FRCManager& dummy = getFRCManager();
 
 FRCManager::FRCManager() :
-    helpRouter(2 * hardwareConcurrency())
+    helpRouter(2 * hardwareConcurrency()),
+    collectorsRunning(false)
 {
-    getDestructorMap(); // we need to make sure the destructorMap has a lifetime that exceeds the FRCManager
+    getLogSegmentPool(); // we need to make sure the log segments held by ThreadData outlive the FRCManager
+    getPoolAllocator(); // and for the pool that FRC objects are freed into
+    PinSet::registerPinWriters();
     writeFence();
 }
 
 FRCManager::~FRCManager()
 {
+    stopCollectors();
+
     auto td = registerThread();
     helpRouter.collect(td);
     unregisterThread();
@@ -72,10 +90,17 @@ ThreadData* FRCManager::registerThread()
         return threadData;
     }
 
-    threadData = new ThreadData();
+    auto& manager = getFRCManager();
+    auto td = manager.helpRouter.reuseThreadData();
+    if(td != nullptr)
+        td->reattach();
+    else
+        td = new ThreadData();
+
+    threadData = td;
     threadDataRegistrationCount = 1;
 
-    getFRCManager().helpRouter.addThread(threadData);
+    manager.helpRouter.addThread(threadData);
 
     if(debug)
         dprint("registerThread: %p\n", threadData);
@@ -90,11 +115,13 @@ void FRCManager::unregisterThread()
     if(threadDataRegistrationCount == 1)
     {
         auto& manager = getFRCManager();
-        for(sz i = 0; i < FRCConstants::numTryHelpCallsOnUnregister; ++i)
+        for(sz i = 0; i < FRCConstants::numTryHelpCallsOnUnregister &&
+                !threadData->allWorkComplete(); ++i)
             manager.help();
 
         threadData->detach();
         threadData = nullptr;
+        MemoryBudget::flush();
     }
 
     --threadDataRegistrationCount;
@@ -105,6 +132,101 @@ bool FRCManager::isThreadRegistered() noexcept
     return threadDataRegistrationCount > 0;
 }
 
+void FRCManager::setThreadDataPoolCapacity(sz capacity)
+{
+    getFRCManager().helpRouter.setThreadDataPoolCapacity(capacity);
+}
+
+/**
+ * Starts background threads that continuously process scan and sweep tasks.
+ * While collectors are running, mutator threads under the default help policy
+ * only help inline once their logs grow past maxLogSizeBeforeHelpIntervalReduction.
+ */
+void FRCManager::startCollectors(sz numCollectors)
+{
+    auto& manager = getFRCManager();
+    std::unique_lock<std::mutex> collectorLock(manager.collectorMutex);
+    if(numCollectors == 0 || !manager.collectors.empty())
+        return;
+
+    manager.collectorsRunning.store(true, orls);
+    for(sz i = 0; i < numCollectors; ++i)
+        manager.collectors.emplace_back(&FRCManager::runCollector, &manager);
+
+    manager.helpRouter.setNumCollectors((uint) numCollectors);
+}
+
+void FRCManager::stopCollectors()
+{
+    auto& manager = getFRCManager();
+    std::unique_lock<std::mutex> collectorLock(manager.collectorMutex);
+    if(manager.collectors.empty())
+        return;
+
+    //mutators resume helping inline before the collectors go away
+    manager.helpRouter.setNumCollectors(0);
+    manager.collectorsRunning.store(false, orls);
+    for(auto& collector : manager.collectors)
+        collector.join();
+
+    manager.collectors.clear();
+}
+
+/**
+ * Sets the help policy of threads registered from now on, and of the calling
+ * thread. Threads already registered keep theirs.
+ */
+void FRCManager::setHelpPolicy(HelpPolicyType type)
+{
+    HelpPolicy::setDefaultType(type);
+    if(isThreadRegistered())
+        threadData->setHelpPolicy(type);
+}
+
+/**
+ * Sets soft and hard limits on the bytes held by FRC objects (0 for none).
+ * Past the soft limit mutators help more often, and past the hard limit they
+ * collect synchronously. The callback is told each change of pressure.
+ */
+void FRCManager::setMemoryBudget(sz softLimit, sz hardLimit, MemoryBudget::Callback callback)
+{
+    MemoryBudget::setBudget(softLimit, hardLimit, std::move(callback));
+}
+
+/**
+ * @return the number of sweep blocks split by help calls that ran out of
+ * their helpBudgetTicks
+ */
+sz FRCManager::getNumSweepsDeferred() noexcept
+{
+    return getFRCManager().helpRouter.getNumSweepsDeferred();
+}
+
+void FRCManager::runCollector()
+{
+    FRCToken token;
+
+    sz numIdle = 0;
+    while(collectorsRunning.load(oacq))
+    {
+        if(threadData->collectorHelp())
+        {
+            numIdle = 0;
+            continue;
+        }
+
+        if(++numIdle < FRCConstants::numCollectorSpinsBeforeSleep)
+        {
+            Relaxer::relax();
+        }
+        else
+        {
+            std::this_thread::sleep_for(
+                std::chrono::microseconds(FRCConstants::collectorSleepMicroseconds));
+        }
+    }
+}
+
 void FRCManager::help()
 {
     if(!isThreadRegistered())
@@ -117,6 +239,9 @@ void FRCManager::collect()
 {
     FRCToken token;
     getFRCManager().helpRouter.collect(threadData);
+
+    //exited threads' objects may have just been freed
+    getPoolAllocator().releaseEmptyCaches();
 }
 
 bool isThreadRegistered() noexcept
@@ -15,6 +15,9 @@
 #pragma once
 
 #include <cassert>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <util/util.h>
 #include <synchronization/MutexSpin.h>
@@ -80,9 +83,29 @@ public:
 
     static bool isThreadRegistered() noexcept;
 
+    static void setThreadDataPoolCapacity(sz capacity);
+
+    static void startCollectors(sz numCollectors);
+
+    static void stopCollectors();
+
+    static void setHelpPolicy(HelpPolicyType type);
+
+    static void setMemoryBudget(sz softLimit, sz hardLimit, MemoryBudget::Callback callback);
+
+    static sz getNumSweepsDeferred() noexcept;
+
+private:
+
+    void runCollector();
+
 private:
 
     HelpRouter helpRouter;
+
+    std::mutex collectorMutex;
+    std::vector<std::thread> collectors;
+    atm<bool> collectorsRunning;
 };
 
 extern bool isThreadRegistered() noexcept;
@@ -0,0 +1,191 @@
+/*
+ * File: HelpPolicy.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <algorithm>
+
+#include "HelpPolicy.h"
+#include "ThreadData.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+atm<HelpPolicyType> HelpPolicy::defaultType(FRCConstants::defaultHelpPolicy);
+
+std::unique_ptr<HelpPolicy> HelpPolicy::make(HelpPolicyType type)
+{
+    switch(type)
+    {
+    case HelpPolicyType::bytesInFlight:
+        return std::unique_ptr<HelpPolicy>(new BytesInFlightHelpPolicy());
+    case HelpPolicyType::latency:
+        return std::unique_ptr<HelpPolicy>(new LatencyHelpPolicy());
+    case HelpPolicyType::logSize:
+    default:
+        return std::unique_ptr<HelpPolicy>(new LogSizeHelpPolicy());
+    }
+}
+
+HelpPolicyType HelpPolicy::getDefaultType() noexcept
+{
+    return defaultType.load(oacq);
+}
+
+void HelpPolicy::setDefaultType(HelpPolicyType type) noexcept
+{
+    defaultType.store(type, orls);
+}
+
+/**
+ * @return the help interval for a log holding logUsed decrements
+ */
+static sz getLogSizeHelpInterval(sz logUsed) noexcept
+{
+    //make help interval shrink as the log grows
+    auto helpInterval = FRCConstants::baseHelpInterval;
+    if(logUsed > FRCConstants::maxLogSizeBeforeHelpIntervalReduction)
+    {
+        /* Exponentially decrease help interval past this point to exert increasing
+         * back-pressure on log processing. Closed-loop feedback control.
+         */
+
+        auto excessUsage = logUsed - FRCConstants::maxLogSizeBeforeHelpIntervalReduction;
+        auto excess = 1 + excessUsage / FRCConstants::helpIntervalReductionConstant;
+        helpInterval = std::max((sz)1, (sz)(helpInterval / excess));
+    }
+
+    return helpInterval;
+}
+
+HelpAction LogSizeHelpPolicy::beginHelp(HelpStatus const& status) noexcept
+{
+    //with background collectors running, only help inline once the log is backing up
+    if(!status.hasCollectors || status.logUsed > FRCConstants::maxLogSizeBeforeHelpIntervalReduction)
+        return HelpAction::tryHelp;
+    return HelpAction::none;
+}
+
+sz LogSizeHelpPolicy::endHelp(sz logUsed) noexcept
+{
+    return getLogSizeHelpInterval(logUsed);
+}
+
+BytesInFlightHelpPolicy::BytesInFlightHelpPolicy() noexcept :
+    averageEntryBytes(0),
+    integral(0),
+    lastError(0),
+    output(0)
+{
+}
+
+/**
+ * Sizes up to numHelpSizeSamples of the recent entries, spread evenly. They
+ * were logged since the last help call, so no helper can have swept them yet.
+ */
+void BytesInFlightHelpPolicy::sampleEntryBytes(HelpStatus const& status) noexcept
+{
+    if(status.numRecent == 0)
+        return;
+
+    auto stride = std::max((sz) 1, status.numRecent / FRCConstants::numHelpSizeSamples);
+    sz bytes = 0;
+    sz numSamples = 0;
+    for(sz i = 0; i < status.numRecent && numSamples < FRCConstants::numHelpSizeSamples; i += stride)
+    {
+        bytes += status.recent[i]->getAllocationSize();
+        ++numSamples;
+    }
+
+    float sample = (float) bytes / numSamples;
+    if(averageEntryBytes == 0)
+        averageEntryBytes = sample;
+    else
+        averageEntryBytes += (sample - averageEntryBytes) / 8;
+}
+
+HelpAction BytesInFlightHelpPolicy::beginHelp(HelpStatus const& status) noexcept
+{
+    sampleEntryBytes(status);
+
+    //error is relative to the target, so the gains don't depend on it
+    float bytesInFlight = status.logUsed * averageEntryBytes;
+    float error = bytesInFlight / FRCConstants::helpTargetBytesInFlight - 1;
+
+    //the controller can only add help, so don't let idle time build up a negative integral
+    integral = std::min(std::max(integral + error, 0.0f), FRCConstants::maxHelpIntegral);
+    float derivative = error - lastError;
+    lastError = error;
+
+    output = FRCConstants::helpProportionalGain * error +
+             FRCConstants::helpIntegralGain * integral +
+             FRCConstants::helpDerivativeGain * derivative;
+
+    if(output >= FRCConstants::helpBlockingOutput)
+        return HelpAction::help;
+    if(!status.hasCollectors || output > 0)
+        return HelpAction::tryHelp;
+    return HelpAction::none;
+}
+
+sz BytesInFlightHelpPolicy::endHelp(sz logUsed) noexcept
+{
+    //small entries can fill the log before their bytes pass the target
+    auto helpInterval = getLogSizeHelpInterval(logUsed);
+    if(output <= 0)
+        return helpInterval;
+    return std::min(helpInterval, std::max((sz) 1, (sz)(FRCConstants::baseHelpInterval / (1 + output))));
+}
+
+LatencyHelpPolicy::LatencyHelpPolicy() noexcept :
+    averageHelpNanoseconds(0),
+    timing(false)
+{
+}
+
+HelpAction LatencyHelpPolicy::beginHelp(HelpStatus const& status) noexcept
+{
+    if(status.hasCollectors && status.logUsed <= FRCConstants::maxLogSizeBeforeHelpIntervalReduction)
+        return HelpAction::none;
+
+    timing = true;
+    start = std::chrono::steady_clock::now();
+    return HelpAction::tryHelp;
+}
+
+sz LatencyHelpPolicy::endHelp(sz logUsed) noexcept
+{
+    if(timing)
+    {
+        timing = false;
+        float elapsed = std::chrono::duration<float, std::nano>(
+                            std::chrono::steady_clock::now() - start).count();
+        if(averageHelpNanoseconds == 0)
+            averageHelpNanoseconds = elapsed;
+        else
+            averageHelpNanoseconds += (elapsed - averageHelpNanoseconds) / 8;
+    }
+
+    if(logUsed > FRCConstants::maxLogSizeBeforeHelpIntervalReduction)
+        return getLogSizeHelpInterval(logUsed);
+
+    auto helpInterval = (sz)(averageHelpNanoseconds / FRCConstants::helpLatencyBudgetNanoseconds);
+    return std::min(std::max(helpInterval, FRCConstants::baseHelpInterval), FRCConstants::maxHelpInterval);
+}
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
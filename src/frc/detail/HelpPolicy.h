@@ -0,0 +1,163 @@
+/*
+ * File: HelpPolicy.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <util/util.h>
+
+#include "FRCConstants.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+class ObjectHeader;
+
+/**
+ * What a thread's log looks like when it reaches its help index.
+ */
+struct HelpStatus
+{
+    sz logUsed; //outstanding decrements
+    ObjectHeader* const* recent; //entries logged since the last help call (possibly a suffix)
+    sz numRecent;
+    bool hasCollectors;
+};
+
+enum class HelpAction : byte
+{
+    none,
+    tryHelp, //process at most one task
+    help //block until a task is processed
+};
+
+/**
+ * Decides how much collection work a mutator does inline, and how often.
+ * Each thread owns its policy, so implementations may keep unsynchronized state.
+ *
+ * Whatever the policy, a thread whose log exceeds maxLogSizeBeforeBlockingHelpCall
+ * spills its new decrements to the overflow queue, or blocks on help if
+ * enableOverflowSpill is off.
+ */
+class HelpPolicy
+{
+public:
+    virtual ~HelpPolicy()
+    {
+    }
+
+    /**
+     * Called when the owning thread reaches its help index.
+     */
+    virtual HelpAction beginHelp(HelpStatus const& status) noexcept = 0;
+
+    /**
+     * Called after the action returned by beginHelp() has been taken.
+     * @return number of decrements to log before the next help call
+     */
+    virtual sz endHelp(sz logUsed) noexcept = 0;
+
+    static std::unique_ptr<HelpPolicy> make(HelpPolicyType type);
+
+    /**
+     * The policy given to threads as they register.
+     */
+    static HelpPolicyType getDefaultType() noexcept;
+
+    static void setDefaultType(HelpPolicyType type) noexcept;
+
+private:
+    static atm<HelpPolicyType> defaultType;
+};
+
+/**
+ * Helps every baseHelpInterval decrements, shrinking the interval past
+ * maxLogSizeBeforeHelpIntervalReduction. With background collectors running,
+ * only helps once the log is backing up.
+ */
+class LogSizeHelpPolicy : public HelpPolicy
+{
+public:
+    HelpAction beginHelp(HelpStatus const& status) noexcept override;
+
+    sz endHelp(sz logUsed) noexcept override;
+};
+
+/**
+ * A PID controller on the bytes held by this thread's outstanding decrements,
+ * for services whose memory use matters more than the number of log entries.
+ * Object sizes are sampled from the recently logged entries, so bytes in
+ * flight are estimated as logUsed times a moving average entry size.
+ *
+ * Below helpTargetBytesInFlight it behaves like LogSizeHelpPolicy; above it,
+ * the help interval shrinks with the controller's output, and the thread
+ * blocks on help once the output passes helpBlockingOutput. The interval is
+ * never longer than LogSizeHelpPolicy's, so small entries still can't fill
+ * the log.
+ */
+class BytesInFlightHelpPolicy : public HelpPolicy
+{
+public:
+    BytesInFlightHelpPolicy() noexcept;
+
+    HelpAction beginHelp(HelpStatus const& status) noexcept override;
+
+    sz endHelp(sz logUsed) noexcept override;
+
+    float getAverageEntryBytes() const noexcept
+    {
+        return averageEntryBytes;
+    }
+
+private:
+    void sampleEntryBytes(HelpStatus const& status) noexcept;
+
+private:
+    float averageEntryBytes;
+    float integral;
+    float lastError;
+    float output;
+};
+
+/**
+ * Bounds the time a mutator spends helping inline, amortized per logged
+ * decrement, to helpLatencyBudgetNanoseconds: the help interval stretches as
+ * help calls get slower, up to maxHelpInterval. The log absorbs the
+ * difference until it reaches maxLogSizeBeforeHelpIntervalReduction, where
+ * this falls back to LogSizeHelpPolicy's back-pressure.
+ */
+class LatencyHelpPolicy : public HelpPolicy
+{
+public:
+    LatencyHelpPolicy() noexcept;
+
+    HelpAction beginHelp(HelpStatus const& status) noexcept override;
+
+    sz endHelp(sz logUsed) noexcept override;
+
+private:
+    std::chrono::steady_clock::time_point start;
+    float averageHelpNanoseconds;
+    bool timing;
+};
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
@@ -12,6 +12,7 @@
  */
 
 #include <util/DebugPrintf.h>
+#include <chrono>
 #include <util/FastRNG.h>
 #include "HelpRouter.h"
 #include "ThreadData.h"
@@ -23,20 +24,39 @@ namespace frc
 namespace detail
 {
 
+//1 + the index of this thread's first task slot; 0: not yet assigned
+static tls(sz, taskSlotHint);
+
 HelpRouter::HelpRouter(sz numGroups) :
-    phase(scan),
-    scanQueue(numGroups),
-    sweepQueue(numGroups)
+    step(0),
+    numCollectors(0),
+    numDeferredSweeps(0),
+    numSweepsDeferred(0),
+    numStepsCompleted(0),
+    numOverflowSegments(0),
+    numSpilled(0),
+    numSpillsSwept(0),
+    taskSlots(new TaskSlot[FRCConstants::numTaskSlots]),
+    numTaskSlotsAssigned(0),
+    lastStallCheck(0),
+    threadDataPoolCapacity(FRCConstants::maxPooledThreadData)
 {
-    queues[scan] = &scanQueue;
-    queues[sweep] = &sweepQueue;
+    for(auto& phaseQueues : queues)
+    {
+        for(auto& queue : phaseQueues)
+            queue.reset(new Queue(numGroups));
+    }
 
     writeFence();
 }
 
 HelpRouter::~HelpRouter()
 {
-    ;
+    for(auto td : threadDataPool)
+        delete td;
+
+    for(auto& overflow : overflowSegments)
+        getLogSegmentPool().release(overflow.segment);
 }
 
 void HelpRouter::addThread(ThreadData* td)
@@ -44,56 +64,70 @@ void HelpRouter::addThread(ThreadData* td)
     td->helpRouter = this;
 
     readFence();
-    auto p = phase;
-    enqueueThread(td, p, oarl);
-    phaseCV.notify_one();
+    auto s = step;
+    enqueueThread(td, s, oarl);
+    stepCV.notify_one();
 
     /* This prevents stalls when this is the only queued thread, but it was queued
-     * to the next phase instead of this phase. This can happen if running threads
+     * to the next step instead of this step. This can happen if running threads
      * are concurrently leaving the router while this lone thread is being added.
      */
     readFence();
-    if(phase != p && !queues[phase]->barrier.status(orlx))
-        tryAdvancePhase();
+    if(step != s && isStepComplete(step))
+        tryAdvanceStep();
 }
 
 bool HelpRouter::tryHelp(ThreadData* td)
 {
-    return tryHelpSubqueue(phase, td->subqueue) || tryHelp();
+    auto s = step;
+    return tryHelpDeferred() ||
+           tryHelpOverflow() ||
+           tryHelpSubqueue(scan, s, td->subqueue[scan]) ||
+           tryHelpSubqueue(sweep, s, td->subqueue[sweep]) ||
+           tryHelp();
 }
 
 bool HelpRouter::tryHelp()
 {
-    auto p = phase;
-    auto& queue = *queues[p];
-    auto index = queue.router.findAcquired();
-    if(index == StaticTreeRouter::notFound)
-        return false;
+    /* Spilled segments go first: a step always has tasks queued, so they'd
+     * never be reached otherwise. They can't crowd out the steps for long,
+     * since each one waits two steps to become sweepable.
+     */
+    if(tryHelpDeferred() || tryHelpOverflow())
+        return true;
+
+    auto s = step;
+    for(auto p : {scan, sweep})
+    {
+        auto index = queues[p][s]->router.findAcquired();
+        if(index != StaticTreeRouter::notFound && tryHelpSubqueue(p, s, index))
+            return true;
+    }
 
-    return tryHelpSubqueue(p, index);
+    return tryHelpStalled();
 }
 
-bool HelpRouter::tryHelpSubqueue(uint p, uint index)
+bool HelpRouter::tryHelpSubqueue(uint p, uint s, uint index)
 {
-    auto& queue = *queues[p];
+    auto& queue = *queues[p][s];
     auto& subqueue = queue.subqueues[index];
     auto subqueueLock = subqueue.mutex.acquire();
     auto& subqq = subqueue.queue;
-    if(p != phase || subqq.empty())
+    if(s != step || subqq.empty())
         return false;
 
     auto td = subqq.back();
     bool complete = td->tryHelp(
-                        phase,
+                        p,
                         [&](bool lastTask)
     {
         if(lastTask)
         {
             //thread is done dispatching: dequeue it
-            if(debug) dout("thread released ", td, " ", phase);
+            if(debug) dout("thread released ", td, " ", p, " ", s);
 
-            td->lastPhaseDispatched = p;
-            while(!subqq.empty() && subqq.back()->lastPhaseDispatched == p)
+            td->lastStepDispatched[p] = s;
+            while(!subqq.empty() && subqq.back()->lastStepDispatched[p] == s)
                 subqq.pop_back();
 
             if(subqq.empty())
@@ -106,43 +140,103 @@ bool HelpRouter::tryHelpSubqueue(uint p, uint index)
     if(!complete)
         return true; //task finished but thread still has work remaining during this phase
 
+    completePhase(td, p, s, index);
+    return true;
+}
+
+/**
+ * Finishes a deferred sweep block, ahead of any new work: the step cannot
+ * end without it.
+ */
+bool HelpRouter::tryHelpDeferred()
+{
+    if(numDeferredSweeps.load(oacq) == 0)
+        return false;
+
+    DeferredSweep deferred;
+    {
+        auto deferredLock = deferredMutex.acquire();
+        if(deferredSweeps.empty())
+            return false;
+
+        deferred = deferredSweeps.back();
+        deferredSweeps.pop_back();
+        numDeferredSweeps.store(deferredSweeps.size(), orlx);
+    }
+
+    //the step can't advance while this block is outstanding, nor its thread be requeued
+    if(deferred.slot != nullptr)
+    {
+        //a helper taking over the block may have completed it since
+        if(!deferred.slot->join(deferred.state))
+            return true;
+
+        if(auto td = ThreadData::sweepClaimed(*deferred.slot, deferred.state, false))
+            completePhase(td, sweep, step, td->subqueue[sweep]);
+        return true;
+    }
+
+    auto s = step;
+
+    auto td = deferred.td;
+    if(td->sweepRange(deferred.segment, deferred.begin, deferred.end))
+        completePhase(td, sweep, s, td->subqueue[sweep]);
+    return true;
+}
+
+/**
+ * Called once a thread's work for phase p of step s is done.
+ */
+void HelpRouter::completePhase(ThreadData* td, uint p, uint s, uint index)
+{
+    auto& queue = *queues[p][s];
+    auto& subqueue = queue.subqueues[index];
+
     //thread's work is complete for this phase
-    if(debug) dout("thread completed ", td, " ", phase);
+    if(debug) dout("thread completed ", td, " ", p, " ", s);
 
-    bool deleting = (phase == sweep && td->isReadyToDestruct());
-    if(!deleting)
+    //the thread's other phase may still be running: the last to complete moves it on
+    bool deleting = false;
+    if(td->numPendingPhases.fetch_sub(1, oarl) == 1)
     {
-        //enqueue thread in the next phase's queue
-        auto next = p ^ 1;
-        enqueueThread(td, next);
+        deleting = td->isReadyToDestruct();
+        if(!deleting)
+            enqueueThread(td, s ^ 1); //enqueue thread in the next step's queues
     }
 
 
-    if(subqueue.count.fetch_sub(1, oarl) <= 1) //release subqueue count...
+    /* The count and barrier are updated under the subqueue lock, so a thread being
+     * concurrently enqueued into this subqueue cannot have its barrier acquisition
+     * overwritten by this release.
+     */
+    bool phaseCompleted = false;
     {
-        if(queue.barrier.release(index)) //subqueue completed: release barrier
-        {
-            tryAdvancePhase(); //phase completed: advance to next phase
-        }
+        auto countLock = subqueue.mutex.acquire();
+        if(subqueue.count.fetch_sub(1, oarl) <= 1) //release subqueue count...
+            phaseCompleted = queue.barrier.release(index); //subqueue completed: release barrier
     }
 
+    if(phaseCompleted)
+        tryAdvanceStep(); //step completed if the other phase has too
+
     if(deleting)
     {
-        //thread has detached and logs have been processed: delete this ThreadData
-        if(debug) dout("destructing thread ", td, " ", phase);
-        delete td;
+        //thread has detached and logs have been processed: recycle this ThreadData
+        if(debug) dout("recycling thread ", td, " ", s);
+        recycleThreadData(td);
     }
-
-    return true;
 }
 
 void HelpRouter::help(ThreadData* td)
 {
     if(!tryHelp(td))
-        help();
+        help(td->getHelpDeadline());
 }
 
-void HelpRouter::help()
+/**
+ * Blocks until a task is processed, or until the deadline passes if there is one.
+ */
+void HelpRouter::help(ticks deadline)
 {
     for(;;)
     {
@@ -152,66 +246,332 @@ void HelpRouter::help()
                 return;
         }
 
-        std::unique_lock<std::mutex> phaseLock(phaseMutex);
-        if(queues[phase]->barrier.status(orlx) && !queues[phase]->router.status(orlx))
+        if(deadline != 0 && getticks() > deadline)
+            return;
+
+        std::unique_lock<std::mutex> stepLock(stepMutex);
+        auto s = step;
+        if(!isStepComplete(s) && numDeferredSweeps.load(orlx) == 0 &&
+                !queues[scan][s]->router.status(orlx) && !queues[sweep][s]->router.status(orlx))
         {
-            if(debug) dout("Waiting on phaseCV.");
-            phaseCV.wait(phaseLock);
+            if(debug) dout("Waiting on stepCV.");
+            if(deadline != 0)
+                stepCV.wait_for(stepLock, std::chrono::microseconds(FRCConstants::helpWaitMicroseconds));
+            else if(FRCConstants::taskStallTicks != 0)
+                stepCV.wait_for(stepLock, std::chrono::microseconds(FRCConstants::stallWaitMicroseconds));
+            else
+                stepCV.wait(stepLock);
         }
     }
 }
 
 void HelpRouter::collect(ThreadData* td)
 {
+    td->flushSpill();
+    auto spilled = numSpilled.load(oacq);
+
     do
     {
         for(sz i = 0; i < 2 * 8; ++i)
         {
             readFence();
-            auto start = phase;
+            auto start = step;
             do
             {
                 td->help();
                 readFence();
             }
-            while(phase == start);
+            while(step == start);
         }
 
+        while(tryHelpOverflow())
+            ;
     }
-    while(!td->allWorkComplete());
+    while(!td->allWorkComplete() || numSpillsSwept.load(oacq) < spilled);
 }
 
-void HelpRouter::enqueueThread(ThreadData* td, uint p, std::memory_order mo)
+/**
+ * Helps through up to numEmergencyCollectionSteps steps, without a time
+ * budget, until FRC's heap is back under the hard limit.
+ */
+void HelpRouter::emergencyCollect()
 {
-    auto& queue = *queues[p];
+    for(sz i = 0; i < FRCConstants::numEmergencyCollectionSteps &&
+            MemoryBudget::getPressure() == MemoryPressure::hard; ++i)
+    {
+        readFence();
+        auto start = step;
+        do
+        {
+            help();
+            readFence();
+        }
+        while(step == start);
+    }
+}
+
+/**
+ * Queues the rest of a sweep block for other helpers.
+ */
+void HelpRouter::deferSweep(ThreadData* td, LogSegment* segment, sz begin, sz end)
+{
+    {
+        auto deferredLock = deferredMutex.acquire();
+        deferredSweeps.push_back({nullptr, 0, td, segment, begin, end});
+        numDeferredSweeps.store(deferredSweeps.size(), orls);
+    }
+    numSweepsDeferred.fetch_add(1, orlx);
+
+    //wake helpers waiting for the step, which can't end without this block
+    {
+        std::lock_guard<std::mutex> stepLock(stepMutex);
+    }
+    stepCV.notify_all();
+}
+
+/**
+ * Queues the unclaimed rest of the sweep block held in a task slot.
+ */
+void HelpRouter::deferSweep(TaskSlot& slot, sz state)
+{
+    {
+        auto deferredLock = deferredMutex.acquire();
+        deferredSweeps.push_back({&slot, state, nullptr, nullptr, 0, 0});
+        numDeferredSweeps.store(deferredSweeps.size(), orls);
+    }
+    numSweepsDeferred.fetch_add(1, orlx);
+
+    {
+        std::lock_guard<std::mutex> stepLock(stepMutex);
+    }
+    stepCV.notify_all();
+}
+
+/**
+ * Finds a free slot to publish this thread's next block in. Each thread has
+ * its own first choice, so slots are rarely shared until helpers outnumber
+ * them.
+ * @return nullptr if none is free, and the block can't be taken over
+ */
+TaskSlot* HelpRouter::acquireTaskSlot() noexcept
+{
+    if(FRCConstants::taskStallTicks == 0)
+        return nullptr;
+
+    if(taskSlotHint == 0)
+        taskSlotHint = numTaskSlotsAssigned.fetch_add(1, orlx) + 1;
+
+    for(sz i = 0; i < FRCConstants::numTaskSlotProbes; ++i)
+    {
+        auto& slot = taskSlots[(taskSlotHint - 1 + i) % FRCConstants::numTaskSlots];
+        if(slot.tryAcquire())
+            return &slot;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Takes over a sweep block whose helpers have made no progress on it for
+ * taskStallTicks, most likely because they were descheduled. The step could
+ * not end without it. Only one helper at a time looks, at most every
+ * taskStallTicks.
+ *
+ * Scan blocks can't be taken over: a descheduled scanner still holds up the
+ * step until it runs again. Another helper could protect the block's pins in
+ * its place, but the scanner would still protect what it read before it
+ * stalled once it wakes, on objects the step's sweeps may have freed since.
+ * Unlike a decrement, an increment isn't safe to apply late.
+ */
+bool HelpRouter::tryHelpStalled()
+{
+    if(FRCConstants::taskStallTicks == 0)
+        return false;
+
+    auto now = getticks();
+    auto last = lastStallCheck.load(orlx);
+    if(now - last < FRCConstants::taskStallTicks ||
+            !lastStallCheck.compare_exchange_strong(last, now, orlx))
+        return false;
+
+    for(sz i = 0; i < FRCConstants::numTaskSlots; ++i)
+    {
+        auto& slot = taskSlots[i];
+        if(!slot.isStalled(now))
+            continue;
+
+        auto state = slot.state.load(oacq);
+        if(!slot.join(state))
+            continue;
+
+        /* A block in a slot belongs to the current step, which can't end
+         * without it: read the step once the block is joined.
+         */
+        if(debug) dout("taking over sweep ", i);
+        if(auto td = ThreadData::sweepClaimed(slot, state, true))
+            completePhase(td, sweep, step, td->subqueue[sweep]);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Queues n decrements spilled from an overflowing log. They wait for the
+ * scans of the next step, like a capture taken now.
+ */
+void HelpRouter::spill(LogSegment* segment, sz n)
+{
+    numSpilled.fetch_add(1, orlx);
+    auto overflowLock = overflowMutex.acquire();
+    overflowSegments.push_back({segment, 0, n, numStepsCompleted});
+    numOverflowSegments.store(overflowSegments.size(), orls);
+}
+
+/**
+ * Sweeps the oldest spilled segment, if it has been scanned past. A helper
+ * with a deadline puts back what it doesn't get to.
+ */
+bool HelpRouter::tryHelpOverflow()
+{
+    if(numOverflowSegments.load(oacq) == 0)
+        return false;
+
+    OverflowSegment overflow;
+    {
+        auto overflowLock = overflowMutex.acquire();
+        if(overflowSegments.empty() || overflowSegments.front().step + 2 > numStepsCompleted)
+            return false;
+
+        overflow = overflowSegments.front();
+        overflowSegments.pop_front();
+        numOverflowSegments.store(overflowSegments.size(), orlx);
+    }
+
+    auto deadline = threadData->getHelpDeadline();
+    auto chunkSize = deadline != 0 ? FRCConstants::sweepChunkSize : FRCConstants::logBlockSize;
+    while(overflow.begin != overflow.end)
+    {
+        auto n = std::min(overflow.end - overflow.begin, chunkSize);
+        threadData->applyDecrements(&overflow.segment->entries[overflow.begin], n);
+        overflow.begin += n;
+
+        if(deadline != 0 && overflow.begin != overflow.end && getticks() > deadline)
+        {
+            auto overflowLock = overflowMutex.acquire();
+            overflowSegments.push_front(overflow);
+            numOverflowSegments.store(overflowSegments.size(), orls);
+            return true;
+        }
+    }
+
+    getLogSegmentPool().release(overflow.segment);
+    numSpillsSwept.fetch_add(1, orls);
+    return true;
+}
+
+/**
+ * Queues a thread for both phases of step s.
+ */
+void HelpRouter::enqueueThread(ThreadData* td, uint s, std::memory_order mo)
+{
+    td->numPendingPhases.store(2, orlx);
+    enqueueThread(td, scan, s, mo);
+    enqueueThread(td, sweep, s, mo);
+}
+
+void HelpRouter::enqueueThread(ThreadData* td, uint p, uint s, std::memory_order mo)
+{
+    auto& queue = *queues[p][s];
     auto index = (uint)FastRNG::next(queue.subqueues.size());
     auto& subqueue = queue.subqueues[index];
 
-    td->lastPhaseDispatched = p ^ 1;
-    td->subqueue = index;
+    td->lastStepDispatched[p] = s ^ 1;
+    td->subqueue[p] = index;
 
     auto subqueueLock = subqueue.mutex.acquire();
 
+    /* The route tracks queue occupancy while the barrier tracks the count: a subqueue
+     * can be emptied by its last dispatch before that thread's work completes, so a
+     * nonzero count does not imply the route is still acquired.
+     */
+    if(subqueue.queue.empty())
+        queue.router.acquire(index);
+
     subqueue.queue.push_back(td);
     if(subqueue.count.fetch_add(1, mo) == 0)
-    {
-        queue.router.acquire(index);
         queue.barrier.acquire(index);
+}
+
+/**
+ * Hands out a drained ThreadData for a newly registering thread, if one is pooled.
+ */
+ThreadData* HelpRouter::reuseThreadData()
+{
+    auto poolLock = poolMutex.acquire();
+    if(threadDataPool.empty())
+        return nullptr;
+
+    auto td = threadDataPool.back();
+    threadDataPool.pop_back();
+    return td;
+}
+
+void HelpRouter::setThreadDataPoolCapacity(sz capacity)
+{
+    std::vector<ThreadData*> excess;
+    {
+        auto poolLock = poolMutex.acquire();
+        threadDataPoolCapacity = capacity;
+        while(threadDataPool.size() > capacity)
+        {
+            excess.push_back(threadDataPool.back());
+            threadDataPool.pop_back();
+        }
+    }
+
+    for(auto td : excess)
+        delete td;
+}
+
+void HelpRouter::recycleThreadData(ThreadData* td)
+{
+    {
+        auto poolLock = poolMutex.acquire();
+        if(threadDataPool.size() < threadDataPoolCapacity)
+        {
+            threadDataPool.push_back(td);
+            return;
+        }
     }
+
+    delete td;
+}
+
+bool HelpRouter::isStepComplete(uint s) const noexcept
+{
+    return !queues[scan][s]->barrier.status(orlx) && !queues[sweep][s]->barrier.status(orlx);
 }
 
-bool HelpRouter::tryAdvancePhase()
+bool HelpRouter::tryAdvanceStep()
 {
     {
-        std::unique_lock<std::mutex> phaseLock(phaseMutex);
-        auto& queue = queues[phase];
-        if(queue->barrier.status(orlx))
-            return false; // phase not yet completed
+        std::unique_lock<std::mutex> stepLock(stepMutex);
+        if(!isStepComplete(step))
+            return false; // step not yet completed
+
+        //every thread has captured for the next step's scans: make pins begun before now visible to them
+        PinSet::serializePinWriters();
+
+        {
+            auto overflowLock = overflowMutex.acquire();
+            ++numStepsCompleted;
+        }
 
-        phase ^= 1; //advance phase
+        step ^= 1; //advance step
     }
 
-    phaseCV.notify_all();
+    stepCV.notify_all();
     return true;
 }
 
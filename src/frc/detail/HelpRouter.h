@@ -13,12 +13,15 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <synchronization/StaticTreeRouter.h>
 #include "FRCConstants.h"
 #include "ThreadData.h"
+#include "TaskSlot.h"
 
 namespace terrain
 {
@@ -29,6 +32,13 @@ namespace detail
 
 class ThreadData;
 
+/**
+ * Routes helpers to collection work. Collection runs in steps: each step
+ * scans every thread's pins for one epoch while sweeping the decrements of
+ * the epoch before, so that helpers find work in either phase. A step ends
+ * once every thread has finished both its phases, and each thread is
+ * queued for the next step when it does.
+ */
 class HelpRouter
 {
 public:
@@ -46,14 +56,47 @@ public:
     bool tryHelp(ThreadData* td);
     bool tryHelp();
     void help(ThreadData* td);
-    void help();
+    void help(ticks deadline = 0);
     void collect(ThreadData* td);
+    void emergencyCollect();
+    void deferSweep(ThreadData* td, LogSegment* segment, sz begin, sz end);
+    void deferSweep(TaskSlot& slot, sz state);
+    TaskSlot* acquireTaskSlot() noexcept;
+    void spill(LogSegment* segment, sz n);
+    bool tryHelpOverflow();
+
+    ThreadData* reuseThreadData();
+    void setThreadDataPoolCapacity(sz capacity);
+
+    bool hasCollectors() const noexcept
+    {
+        return numCollectors.load(orlx) != 0;
+    }
+
+    void setNumCollectors(uint n) noexcept
+    {
+        numCollectors.store(n, orls);
+    }
+
+    /**
+     * @return the number of sweep blocks helpers have deferred so far
+     */
+    sz getNumSweepsDeferred() const noexcept
+    {
+        return numSweepsDeferred.load(orlx);
+    }
 
 private:
 
-    bool tryHelpSubqueue(uint index, uint p);
-    void enqueueThread(ThreadData* td, uint p, std::memory_order mo = oarl);
-    bool tryAdvancePhase();
+    bool tryHelpSubqueue(uint p, uint s, uint index);
+    bool tryHelpDeferred();
+    bool tryHelpStalled();
+    void completePhase(ThreadData* td, uint p, uint s, uint index);
+    void enqueueThread(ThreadData* td, uint s, std::memory_order mo = oarl);
+    void enqueueThread(ThreadData* td, uint p, uint s, std::memory_order mo);
+    bool isStepComplete(uint s) const noexcept;
+    bool tryAdvanceStep();
+    void recycleThreadData(ThreadData* td);
 
 private:
     static constexpr auto scan = FRCConstants::scan;
@@ -91,15 +134,65 @@ private:
         }
     };
 
+    /**
+     * The rest of a sweep block whose helper ran out of time. It still counts
+     * against its thread's sweep, so the step waits for it.
+     */
+    struct DeferredSweep
+    {
+        TaskSlot* slot; //holds the block, if not null
+        sz state; //of the slot
+        ThreadData* td;
+        LogSegment* segment; //holds begin
+        sz begin;
+        sz end;
+    };
+
+    /**
+     * Decrements spilled out of an overflowing log. They belong to no thread's
+     * sweep, so steps don't wait for them.
+     */
+    struct OverflowSegment
+    {
+        LogSegment* segment;
+        sz begin; //entries [begin, end) are still to be swept
+        sz end;
+        sz step; //spilled during this step: sweepable once the next has completed
+    };
+
 private:
-    uint phase;
-    Queue* queues[2];
-    Queue scanQueue, sweepQueue;
+    uint step; //parity of the current step
+    atm<uint> numCollectors; //background collector threads running
+    std::unique_ptr<Queue> queues[2][2]; //by phase, then by step parity
 
     cacheLinePadding p0;
-    std::mutex phaseMutex;
-    std::condition_variable phaseCV;
+    std::mutex stepMutex;
+    std::condition_variable stepCV;
     cacheLinePadding p1;
+
+    MutexSpin deferredMutex;
+    std::vector<DeferredSweep> deferredSweeps;
+    atm<sz> numDeferredSweeps; //queued
+    atm<sz> numSweepsDeferred; //ever
+    cacheLinePadding p2;
+
+    MutexSpin overflowMutex;
+    std::deque<OverflowSegment> overflowSegments;
+    sz numStepsCompleted; //under overflowMutex, so a spill is ordered against the step flips
+    atm<sz> numOverflowSegments; //queued
+    atm<sz> numSpilled;
+    atm<sz> numSpillsSwept;
+    cacheLinePadding p3;
+
+    std::unique_ptr<TaskSlot[]> taskSlots; //numTaskSlots
+    atm<sz> numTaskSlotsAssigned; //to helper threads, round robin
+    atm<ticks> lastStallCheck;
+    cacheLinePadding p4;
+
+    MutexSpin poolMutex;
+    std::vector<ThreadData*> threadDataPool; //detached and drained, ready for reuse
+    sz threadDataPoolCapacity;
+    cacheLinePadding p5;
 };
 
 } /* namespace detail */
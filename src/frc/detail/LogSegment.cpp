@@ -0,0 +1,80 @@
+/*
+ * File: LogSegment.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "LogSegment.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+LogSegmentPool::LogSegmentPool() :
+    freeList(nullptr),
+    numPooled(0)
+{
+    ;
+}
+
+LogSegmentPool::~LogSegmentPool()
+{
+    while(freeList != nullptr)
+    {
+        auto segment = freeList;
+        freeList = segment->next;
+        delete segment;
+    }
+}
+
+LogSegment* LogSegmentPool::acquire()
+{
+    LogSegment* segment = nullptr;
+    {
+        auto lock = mutex.acquire();
+        if(freeList != nullptr)
+        {
+            segment = freeList;
+            freeList = segment->next;
+            --numPooled;
+        }
+    }
+
+    if(segment == nullptr)
+        segment = new LogSegment;
+
+    segment->next = nullptr;
+    return segment;
+}
+
+void LogSegmentPool::release(LogSegment* segment) noexcept
+{
+    {
+        auto lock = mutex.acquire();
+        if(numPooled < FRCConstants::maxPooledLogSegments)
+        {
+            segment->next = freeList;
+            freeList = segment;
+            ++numPooled;
+            return;
+        }
+    }
+
+    //pool is full: give the memory back
+    delete segment;
+}
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
@@ -0,0 +1,86 @@
+/*
+ * File: LogSegment.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <util/util.h>
+#include <synchronization/MutexSpin.h>
+
+#include "FRCConstants.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+class ObjectHeader;
+class LogSegmentPool;
+
+// We use a function to retrieve the pool to avoid static initialization ordering issues
+LogSegmentPool& getLogSegmentPool(); //defined in FRCManager.cpp
+
+/**
+ * A fixed-size chunk of a decrement log.
+ * Logs are singly linked chains of segments that grow on demand.
+ */
+struct LogSegment
+{
+    static constexpr sz size = FRCConstants::logSegmentSize;
+    static constexpr sz mask = size - 1;
+
+    ObjectHeader* entries[size];
+    LogSegment* next;
+};
+
+/**
+ * Process-wide free list of log segments.
+ * Segments released beyond maxPooledLogSegments are returned to the OS.
+ */
+class LogSegmentPool
+{
+public:
+
+    LogSegmentPool();
+
+    LogSegmentPool(LogSegmentPool const&) = delete;
+
+    LogSegmentPool(LogSegmentPool&&) = delete;
+
+    LogSegmentPool& operator=(LogSegmentPool const&) = delete;
+
+    LogSegmentPool& operator=(LogSegmentPool&&) = delete;
+
+    ~LogSegmentPool();
+
+    LogSegment* acquire();
+
+    void release(LogSegment* segment) noexcept;
+
+    sz getNumPooled() noexcept
+    {
+        auto lock = mutex.acquire();
+        return numPooled;
+    }
+
+private:
+    MutexSpin mutex;
+    LogSegment* freeList;
+    sz numPooled;
+};
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
@@ -0,0 +1,65 @@
+/*
+ * File: MemoryBudget.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "MemoryBudget.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+tls(lng, memoryBudgetDelta);
+
+//constant-initialized, so they are usable before any dynamic initialization
+atm<lng> MemoryBudget::heapBytes(0);
+atm<sz> MemoryBudget::softLimit(0);
+atm<sz> MemoryBudget::hardLimit(0);
+atm<MemoryPressure> MemoryBudget::reportedPressure(MemoryPressure::none);
+
+std::mutex MemoryBudget::callbackMutex;
+MemoryBudget::Callback MemoryBudget::callback;
+
+/**
+ * Sets the soft and hard limits on FRC heap bytes (0 for none), and the
+ * callback told whenever the pressure changes.
+ */
+void MemoryBudget::setBudget(sz softLimit_, sz hardLimit_, Callback callback_)
+{
+    {
+        std::lock_guard<std::mutex> callbackLock(callbackMutex);
+        callback = std::move(callback_);
+    }
+
+    softLimit.store(softLimit_, orlx);
+    hardLimit.store(hardLimit_, orlx);
+    reportedPressure.store(MemoryPressure::none, orls);
+}
+
+void MemoryBudget::notify(MemoryPressure pressure)
+{
+    Callback current;
+    {
+        std::lock_guard<std::mutex> callbackLock(callbackMutex);
+        current = callback;
+    }
+
+    if(current)
+        current(pressure, getHeapBytes());
+}
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
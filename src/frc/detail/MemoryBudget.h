@@ -0,0 +1,133 @@
+/*
+ * File: MemoryBudget.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+
+#include <util/util.h>
+#include <util/tls.h>
+
+#include "FRCConstants.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+//this thread's allocated bytes not yet added to the global count
+extern tls(lng, memoryBudgetDelta);
+
+enum class MemoryPressure : byte
+{
+    none,
+    soft, //mutators help more often
+    hard //mutators collect synchronously
+};
+
+/**
+ * Counts the bytes held by FRC objects, live or awaiting reclamation, against
+ * an optional budget. Threads count into a local delta and add it to the
+ * global count every memoryBudgetFlushBytes, so the count may be off by that
+ * much per thread.
+ *
+ * The budget has to cover the application's live FRC objects as well as the
+ * garbage it tolerates: FRC can't tell which logged decrements are the last.
+ */
+class MemoryBudget
+{
+public:
+    using Callback = std::function<void(MemoryPressure pressure, sz heapBytes)>;
+
+    static void recordAllocation(sz bytes) noexcept
+    {
+        if(!FRCConstants::enableMemoryBudget)
+            return;
+
+        memoryBudgetDelta += bytes;
+        if(memoryBudgetDelta > (lng) FRCConstants::memoryBudgetFlushBytes)
+            flush();
+    }
+
+    static void recordFree(sz bytes) noexcept
+    {
+        if(!FRCConstants::enableMemoryBudget)
+            return;
+
+        memoryBudgetDelta -= bytes;
+        if(memoryBudgetDelta < -(lng) FRCConstants::memoryBudgetFlushBytes)
+            flush();
+    }
+
+    /**
+     * Adds this thread's delta to the global count.
+     */
+    static void flush() noexcept
+    {
+        heapBytes.fetch_add(memoryBudgetDelta, orlx);
+        memoryBudgetDelta = 0;
+    }
+
+    static sz getHeapBytes() noexcept
+    {
+        return (sz) std::max(heapBytes.load(orlx), lng(0));
+    }
+
+    static MemoryPressure getPressure() noexcept
+    {
+        if(!FRCConstants::enableMemoryBudget)
+            return MemoryPressure::none;
+
+        auto bytes = getHeapBytes();
+        auto hard = hardLimit.load(orlx);
+        if(hard != 0 && bytes > hard)
+            return MemoryPressure::hard;
+
+        auto soft = softLimit.load(orlx);
+        if(soft != 0 && bytes > soft)
+            return MemoryPressure::soft;
+
+        return MemoryPressure::none;
+    }
+
+    /**
+     * Calls the callback if the pressure differs from what it was last told.
+     */
+    static void report(MemoryPressure pressure)
+    {
+        if(reportedPressure.load(orlx) != pressure && reportedPressure.exchange(pressure, oarl) != pressure)
+            notify(pressure);
+    }
+
+    static void setBudget(sz softLimit, sz hardLimit, Callback callback);
+
+private:
+    static void notify(MemoryPressure pressure);
+
+private:
+    static atm<lng> heapBytes;
+    static atm<sz> softLimit; //0: none
+    static atm<sz> hardLimit; //0: none
+    static atm<MemoryPressure> reportedPressure;
+
+    static std::mutex callbackMutex;
+    static Callback callback;
+};
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
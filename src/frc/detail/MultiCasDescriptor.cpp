@@ -0,0 +1,206 @@
+/*
+ * File: MultiCasDescriptor.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <algorithm>
+
+#include "MultiCasDescriptor.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+namespace
+{
+
+/**
+ * A pin held for the duration of a scope.
+ */
+struct ScopedPin
+{
+    atm<void*>* pin;
+
+    ScopedPin() noexcept :
+        pin(PinSet::acquire())
+    {
+        pin->store(nullptr, orls);
+    }
+
+    ~ScopedPin() noexcept
+    {
+        while(ThreadData::isScanning())
+            ;
+        PinSet::release(pin);
+    }
+};
+
+} /* namespace */
+
+MultiCasDescriptor::MultiCasDescriptor(MultiCasEntry const* entries_, sz numEntries) noexcept :
+    numEntries(numEntries)
+{
+    assert(numEntries <= FRCConstants::maxMultiCasEntries);
+
+    std::copy(entries_, entries_ + numEntries, entries);
+
+    //a global slot order makes helping lock-free
+    std::sort(entries, entries + numEntries, [](MultiCasEntry const& a, MultiCasEntry const& b)
+    {
+        return a.slot < b.slot;
+    });
+
+    for(sz i = 0; i < numEntries; ++i)
+    {
+        assert(i == 0 || entries[i - 1].slot != entries[i].slot);
+        registerIncrement(entries[i].desired);
+    }
+
+    status.store(undecided, orls);
+}
+
+MultiCasDescriptor::~MultiCasDescriptor() noexcept
+{
+    for(sz i = 0; i < numEntries; ++i)
+        registerDecrement(entries[i].desired);
+}
+
+bool MultiCasDescriptor::help()
+{
+    if(status.load(oacq) == undecided)
+    {
+        uint outcome = succeeded;
+        for(sz i = 0; i < numEntries && outcome == succeeded; ++i)
+        {
+            auto const& entry = entries[i];
+            while(status.load(oacq) == undecided)
+            {
+                auto seen = rdcss(i);
+                if(seen == (uintptr_t) entry.expected || seen == tagged())
+                    break;
+
+                if((seen & tagMask) != multiCasTag)
+                {
+                    outcome = failed;
+                    break;
+                }
+
+                //another operation holds the slot: finish it first
+                ScopedPin pin;
+                auto word = loadPinned(entry.slot, pin.pin);
+                if((word & tagMask) == multiCasTag && word != tagged())
+                    ((MultiCasDescriptor*)(word & ~tagMask))->help();
+            }
+        }
+
+        uint expected = undecided;
+        status.compare_exchange_strong(expected, outcome, oarl, oacq);
+    }
+
+    bool success = status.load(oacq) == succeeded;
+    if(debug) dout("MultiCasDescriptor::help() ", this, " ", success);
+
+    for(sz i = 0; i < numEntries; ++i)
+    {
+        auto const& entry = entries[i];
+        auto current = tagged();
+        auto value = (uintptr_t)(success ? entry.desired : entry.expected);
+        if(entry.slot->compare_exchange_strong(current, value, oarl, orlx))
+        {
+            if(success)
+            {
+                registerIncrement(entry.desired);
+                registerDecrement(entry.expected);
+            }
+            registerDecrement(this); //the slot's count; the caller's pin keeps us alive
+        }
+    }
+
+    return success;
+}
+
+void MultiCasDescriptor::helpWord(uintptr_t word)
+{
+    auto ptr = word & ~tagMask;
+    if((word & tagMask) == rdcssTag)
+        ((RdcssDescriptor*) ptr)->complete();
+    else if((word & tagMask) == multiCasTag)
+        ((MultiCasDescriptor*) ptr)->help();
+}
+
+uintptr_t MultiCasDescriptor::rdcss(sz index)
+{
+    auto const& entry = entries[index];
+    auto expected = (uintptr_t) entry.expected;
+
+    //the initial count is the one the slot takes if the install succeeds
+    ScopedPin pin;
+    auto descriptor = makeNewObject<RdcssDescriptor>(1, this, index);
+    pin.pin->store(descriptor, orls);
+
+    for(;;)
+    {
+        auto seen = expected;
+        if(entry.slot->compare_exchange_strong(seen, descriptor->tagged(), oarl, oacq))
+        {
+            descriptor->complete();
+            return expected;
+        }
+
+        if((seen & tagMask) != rdcssTag)
+        {
+            registerDecrement(descriptor);
+            return seen;
+        }
+
+        ScopedPin other;
+        auto word = loadPinned(entry.slot, other.pin);
+        if((word & tagMask) == rdcssTag)
+            ((RdcssDescriptor*)(word & ~tagMask))->complete();
+    }
+}
+
+RdcssDescriptor::RdcssDescriptor(MultiCasDescriptor* owner, sz index) noexcept :
+    owner(owner),
+    index(index)
+{
+    registerIncrement(owner);
+}
+
+RdcssDescriptor::~RdcssDescriptor() noexcept
+{
+    registerDecrement(owner);
+}
+
+void RdcssDescriptor::complete() noexcept
+{
+    auto const& entry = owner->entries[index];
+    auto current = tagged();
+
+    if(owner->status.load(oacq) == MultiCasDescriptor::undecided)
+    {
+        registerIncrement(owner); //for the slot
+        if(entry.slot->compare_exchange_strong(current, owner->tagged(), oarl, orlx))
+            registerDecrement(this);
+        else
+            registerDecrement(owner);
+    }
+    else if(entry.slot->compare_exchange_strong(current, (uintptr_t) entry.expected, oarl, orlx))
+        registerDecrement(this);
+}
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
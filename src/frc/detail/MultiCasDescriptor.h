@@ -0,0 +1,170 @@
+/*
+ * File: MultiCasDescriptor.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <util/util.h>
+
+#include "FRCConstants.h"
+#include "FRCManager.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+class RdcssDescriptor;
+
+struct MultiCasEntry
+{
+    atm<uintptr_t>* slot;
+    void* expected;
+    void* desired;
+};
+
+/**
+ * Descriptor for one multi-word compare and swap (Harris, Fraser and Pratt).
+ *
+ * The operation first installs the descriptor in each slot in address order,
+ * each through a restricted double-compare single-swap (RDCSS) that only
+ * succeeds while the operation is undecided, then decides, then replaces
+ * itself in every slot by the desired or expected value. Any thread that finds
+ * a descriptor in a slot helps it to completion before going on.
+ *
+ * Descriptors are FRC objects. A slot holding a (tagged) descriptor owns a
+ * count on it, so descriptors can be pinned and read like any other target.
+ * While a descriptor is installed the slot's count on its expected value is
+ * kept; the thread whose CAS finally removes the descriptor moves that count
+ * to the desired value on success. The descriptor itself counts every desired
+ * value until it is destroyed.
+ */
+class MultiCasDescriptor
+{
+private:
+    static constexpr bool debug = false;
+
+    friend class RdcssDescriptor;
+
+public:
+    static constexpr uintptr_t rdcssTag = 1;
+    static constexpr uintptr_t multiCasTag = 2;
+    static constexpr uintptr_t tagMask = 3;
+
+    static constexpr uint undecided = 0;
+    static constexpr uint succeeded = 1;
+    static constexpr uint failed = 2;
+
+public:
+
+    MultiCasDescriptor(MultiCasEntry const* entries, sz numEntries) noexcept;
+
+    MultiCasDescriptor(MultiCasDescriptor const&) = delete;
+
+    MultiCasDescriptor(MultiCasDescriptor&&) = delete;
+
+    MultiCasDescriptor& operator=(MultiCasDescriptor const&) = delete;
+
+    MultiCasDescriptor& operator=(MultiCasDescriptor&&) = delete;
+
+    ~MultiCasDescriptor() noexcept;
+
+    /**
+     * Runs the operation to completion and returns whether it succeeded.
+     * The descriptor must be pinned by the caller.
+     */
+    bool help();
+
+    /**
+     * Reads a slot, pinning whatever it refers to (plain target or descriptor)
+     * in pin, using the same busySignal protocol as PrivatePointer.
+     */
+    static uintptr_t loadPinned(atm<uintptr_t> const* slot, atm<void*>* pin) noexcept
+    {
+        PinSet::beginPin(pin);
+        auto word = slot->load(oacq);
+        PinSet::endPin(pin, (void*)(word & ~tagMask));
+        return word;
+    }
+
+    /**
+     * Completes the descriptor found (and pinned) in a slot, so that the slot can
+     * be read again.
+     */
+    static void helpWord(uintptr_t word);
+
+    static bool isPlain(uintptr_t word) noexcept
+    {
+        return (word & tagMask) == 0;
+    }
+
+private:
+
+    uintptr_t tagged() const noexcept
+    {
+        return (uintptr_t) this | multiCasTag;
+    }
+
+    /**
+     * Installs this descriptor in the slot of the given entry if it still holds the
+     * expected value and the operation is undecided. Returns the value found.
+     */
+    uintptr_t rdcss(sz index);
+
+private:
+    atm<uint> status;
+    sz numEntries;
+    MultiCasEntry entries[FRCConstants::maxMultiCasEntries];
+};
+
+/**
+ * Descriptor for a single RDCSS step of a multi-word CAS. Holds a count on its
+ * owner for as long as it lives.
+ */
+class RdcssDescriptor
+{
+public:
+
+    RdcssDescriptor(MultiCasDescriptor* owner, sz index) noexcept;
+
+    RdcssDescriptor(RdcssDescriptor const&) = delete;
+
+    RdcssDescriptor(RdcssDescriptor&&) = delete;
+
+    RdcssDescriptor& operator=(RdcssDescriptor const&) = delete;
+
+    RdcssDescriptor& operator=(RdcssDescriptor&&) = delete;
+
+    ~RdcssDescriptor() noexcept;
+
+    /**
+     * Replaces this descriptor in its slot by the owner if the owner is still
+     * undecided, and by the expected value otherwise. Must be pinned by the caller.
+     */
+    void complete() noexcept;
+
+    uintptr_t tagged() const noexcept
+    {
+        return (uintptr_t) this | MultiCasDescriptor::rdcssTag;
+    }
+
+private:
+    MultiCasDescriptor* owner;
+    sz index;
+};
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
@@ -24,6 +24,7 @@
 
 #include "FRCConstants.h"
 #include "DestructorMap.h"
+#include "PoolAllocator.h"
 
 namespace terrain
 {
@@ -119,12 +120,30 @@ public:
             return count.fetch_sub(1, oarl) <= 1;
     }
 
+    /**
+     * Applies n combined decrements with a single atomic operation.
+     * @return true if count is <= n, false if it wasn't and was decremented
+     */
+    bool decrement(uint n) noexcept
+    {
+        if(FRCConstants::enableCheckedDecrements)
+            return count.load(ocon) <= n || count.fetch_sub(n, oarl) <= n;
+        else
+            return count.fetch_sub(n, oarl) <= n;
+    }
+
     void decrementAndDestroy() noexcept
     {
         if(decrement())
             destroy();
     }
 
+    void decrementAndDestroy(uint n) noexcept
+    {
+        if(decrement(n))
+            destroy();
+    }
+
     bool isObject() const noexcept
     {
         return (typeCode & 1) == 0;
@@ -137,11 +156,27 @@ public:
 
     sz length() const noexcept;
 
+    /**
+     * @return bytes allocated for this object, header included
+     */
+    sz getAllocationSize() const noexcept;
+
     void destroy() noexcept
     {
+        if(DestructorMap::isTrivial(typeCode))
+        {
+            deallocate(); //nothing to destruct
+            return;
+        }
+
         DestructorMap::callDestructor(this, typeCode);
     }
 
+    /**
+     * Frees this object's memory without running any destructors.
+     */
+    void deallocate() noexcept;
+
     sz getCount() const noexcept
     {
         return count.load(oacq);
@@ -190,18 +225,34 @@ inline sz ObjectHeader::length() const noexcept
     return arrayHeader->length();
 }
 
+inline sz ObjectHeader::getAllocationSize() const noexcept
+{
+    auto typeSize = DestructorMap::getTypeSize(typeCode);
+    if(isObject())
+        return sizeof(ObjectHeader) + typeSize;
+
+    ArrayHeader* arrayHeader = getArrayHeader(this);
+    return sizeof(ArrayHeader) + typeSize * arrayHeader->length();
+}
+
+inline void ObjectHeader::deallocate() noexcept
+{
+    if(isObject())
+    {
+        PoolAllocator::deallocate(this, getAllocationSize());
+        return;
+    }
+
+    PoolAllocator::deallocate(getArrayHeader(this), getAllocationSize());
+}
+
 template<typename T, typename ... Args>
 static T* makeNewObject(uint count, Args&& ... args)
 {
-    /* we need to call getTypeCode() to avoid static initialization order issues.
-     * makeNew is called before TypeCodeInitializer<T>::typeCode is initialized
-     */
-    static auto const typeCode = DestructorMap::getTypeCode<T>();
+    auto const typeCode = DestructorMap::getTypeCode<T>();
 
     static constexpr auto size = sizeof(ObjectHeader) + sizeof(T);
-    auto mem = malloc(size); //allocate memory
-    if(mem == nullptr)
-        throw std::bad_alloc();
+    auto mem = PoolAllocator::allocate(size); //allocate memory
 
     auto const header = new(mem)ObjectHeader(count, typeCode); //place header
 
@@ -211,7 +262,7 @@ static T* makeNewObject(uint count, Args&& ... args)
     }
     catch(...)
     {
-        free(mem); //ok to not destruct header
+        PoolAllocator::deallocate(mem, size); //ok to not destruct header
         throw;
     }
 }
@@ -235,21 +286,42 @@ static void destroyObject(ObjectHeader* header)
         //absorb
     }
 
-    free(header); //ok to not destruct header
+    PoolAllocator::deallocate(header, sizeof(ObjectHeader) + sizeof(T)); //ok to not destruct header
+}
+
+/**
+ * Batched object destructor thunk.
+ * Destroys a group of objects of the same type, then frees their memory.
+ */
+template<class T>
+static void destroyObjects(ObjectHeader** headers, sz n)
+{
+    for(sz i = 0; i < n; ++i)
+    {
+        auto object = (T*) headers[i]->getObject();
+
+        try
+        {
+            object->~T();
+        }
+        catch(...)
+        {
+            assert(false); //Destructors should never throw.
+            //absorb
+        }
+    }
+
+    for(sz i = 0; i < n; ++i)
+        PoolAllocator::deallocate(headers[i], sizeof(ObjectHeader) + sizeof(T)); //ok to not destruct headers
 }
 
 template<typename T>
 static T* makeNewArray(uint count, sz length, bool initialize)
 {
     auto size = sizeof(ArrayHeader) + sizeof(T) * length;
-    auto mem = malloc(size); //allocate memory
-    if(mem == nullptr)
-        throw std::bad_alloc();
+    auto mem = PoolAllocator::allocate(size); //allocate memory
 
-    // we still need to call getTypeCode() to avoid static initialization order issues
-    static auto const typeCode = DestructorMap::getArrayTypeCode<T>();
-
-    // (e.gh makeNew is called before TypeCodeInitializer<T>::typeCode is initialized)
+    auto const typeCode = DestructorMap::getArrayTypeCode<T>();
     auto header = new(mem)ArrayHeader(count, typeCode, length); //place header
 
     try
@@ -278,7 +350,7 @@ static T* makeNewArray(uint count, sz length, bool initialize)
     }
     catch(...)
     {
-        free(mem); //ok to not destruct header
+        PoolAllocator::deallocate(mem, size); //ok to not destruct header
         throw;
     }
 }
@@ -294,20 +366,60 @@ static void destroyArray(ObjectHeader* objectHeader)
     auto arrayHeader = getArrayHeader(objectHeader);
     auto length = arrayHeader->length();
 
-    for(sz i = 0; i < length; ++i)
+    if(!std::is_trivially_destructible<T>::value)
     {
-        try
+        for(sz i = 0; i < length; ++i)
         {
-            array[i].~T();
+            try
+            {
+                array[i].~T();
+            }
+            catch(...)
+            {
+                assert(false); //Destructors should never throw.
+                //absorb
+            }
         }
-        catch(...)
+    }
+
+    PoolAllocator::deallocate(arrayHeader, sizeof(ArrayHeader) + sizeof(T) * length); //ok to not destruct header
+}
+
+/**
+ * Batched array destructor thunk.
+ * Destroys a group of arrays of the same element type, then frees their memory.
+ */
+template<class T>
+static void destroyArrays(ObjectHeader** objectHeaders, sz n)
+{
+    if(!std::is_trivially_destructible<T>::value)
+    {
+        for(sz j = 0; j < n; ++j)
         {
-            assert(false); //Destructors should never throw.
-            //absorb
+            T* array = (T*) objectHeaders[j]->getObject();
+            auto length = getArrayHeader(objectHeaders[j])->length();
+
+            for(sz i = 0; i < length; ++i)
+            {
+                try
+                {
+                    array[i].~T();
+                }
+                catch(...)
+                {
+                    assert(false); //Destructors should never throw.
+                    //absorb
+                }
+            }
         }
     }
 
-    free(arrayHeader); //ok to not destruct header
+    for(sz j = 0; j < n; ++j)
+    {
+        auto arrayHeader = getArrayHeader(objectHeaders[j]);
+        auto size = sizeof(ArrayHeader) + sizeof(T) * arrayHeader->length();
+        PoolAllocator::deallocate(arrayHeader, size); //ok to not destruct headers
+    }
 }
 
 }
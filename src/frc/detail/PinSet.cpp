@@ -11,6 +11,15 @@
  * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
  */
 
+#include <util/Exception.h>
+#include <util/platformSpecific.h>
+
+#ifdef TERRAIN_LINUX
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "PinSet.h"
 
 namespace terrain
@@ -21,17 +30,101 @@ namespace detail
 {
 
 tls(atm<void*>*, head);
+tls(PinSet*, currentPinSet);
 
 PinSet::PinSet() :
-    protectedObjects(new atm<void*>[size])
+    first(new PinBlock),
+    last(first),
+    numBlocks(1),
+    numAcquired(0)
+{
+    first->next.store(nullptr, orlx);
+    reset();
+}
+
+PinSet::~PinSet()
+{
+    for(auto block = first; block != nullptr;)
+    {
+        auto next = block->next.load(orlx);
+        delete block;
+        block = next;
+    }
+}
+
+void PinSet::reset() noexcept
+{
+    for(auto block = first; block != nullptr; block = block->next.load(orlx))
+    {
+        auto next = block->next.load(orlx);
+        auto& lastPin = block->pins[FRCConstants::pinBlockSize - 1];
+        linkFree(block);
+        if(next != nullptr)
+            lastPin.store(tag(&next->pins[0]), orlx);
+    }
+    numAcquired.store(0, orlx);
+    writeFence();
+
+    head = &first->pins[0];
+    currentPinSet = this;
+}
+
+void PinSet::grow()
+{
+    auto block = new PinBlock;
+    block->next.store(nullptr, orlx);
+    linkFree(block);
+
+    last->next.store(block, orls); //scanners walk the chain concurrently
+    last = block;
+    numBlocks.store(numBlocks.load(orlx) + 1, orls);
+
+    head = &block->pins[0];
+}
+
+void PinSet::linkFree(PinBlock* block) noexcept
 {
-    for(sz i = 0; i < (size - 1); ++i)
-        protectedObjects[i].store(&protectedObjects[i + 1], orlx);
-    protectedObjects[size - 1].store(nullptr, orls);
+    auto pins = block->pins;
+    for(sz i = 0; i + 1 < FRCConstants::pinBlockSize; ++i)
+        pins[i].store(tag(&pins[i + 1]), orlx);
+    pins[FRCConstants::pinBlockSize - 1].store(nullptr, orls);
+}
+
+#ifdef TERRAIN_LINUX
 
-    head = &protectedObjects[0];
+void PinSet::registerPinWriters()
+{
+    if(!FRCConstants::enableAsymmetricPinFences)
+        return;
+
+    if(syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) != 0)
+        throw Exception("PinSet: membarrier() is unavailable, disable enableAsymmetricPinFences");
 }
 
+void PinSet::serializePinWriters() noexcept
+{
+    if(!FRCConstants::enableAsymmetricPinFences)
+        return;
+
+    auto result = syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    assert(result == 0);
+    (void) result;
+}
+
+#else
+
+static_assert(!FRCConstants::enableAsymmetricPinFences, "asymmetric pin fences need Linux membarrier()");
+
+void PinSet::registerPinWriters()
+{
+}
+
+void PinSet::serializePinWriters() noexcept
+{
+}
+
+#endif
+
 
 } /* namespace detail */
 } /* namespace frc */
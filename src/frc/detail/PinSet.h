@@ -16,8 +16,13 @@
 
 #include <util/util.h>
 #include <assert.h>
+#include <util/bitTricks.h>
 #include <util/tls.h>
 
+#if defined TERRAIN_X64 && defined TERRAIN_GCC && defined __SSE4_1__
+#include <immintrin.h>
+#endif
+
 #include "FRCConstants.h"
 
 namespace terrain
@@ -27,30 +32,70 @@ namespace frc
 namespace detail
 {
 
+class PinSet;
+
 extern tls(atm<void*>*, head);
+extern tls(PinSet*, currentPinSet);
 
 extern bool isThreadRegistered() noexcept;
 
+/**
+ * A block of pins. Blocks are chained, and only ever appended by the owner.
+ */
+struct PinBlock
+{
+    atm<void*> pins[FRCConstants::pinBlockSize];
+    atm<PinBlock*> next;
+};
+
+/**
+ * A thread's pins, in a growable chain of blocks that scanners walk.
+ *
+ * Free pins form a list through their own slots. Each link is tagged with
+ * freePinTag, so that scanners skip free pins without checking where they
+ * point. Links are never null, so they never read as the busySignal; the
+ * list ends with a plain nullptr.
+ *
+ * The owner also publishes how many pins it holds, so that scanners can skip
+ * threads that hold none.
+ */
 class PinSet
 {
 private:
-    static sz constexpr size = FRCConstants::pinSetSize;
+    static constexpr auto pinOrder = FRCConstants::enableAsymmetricPinFences ? orlx : orls;
 
 public:
+    static constexpr sz scanGroupSize = 8; //see findPinned()
 
     PinSet();
 
+    PinSet(PinSet const&) = delete;
+
+    PinSet& operator=(PinSet const&) = delete;
+
+    ~PinSet();
+
+    /**
+     * Relinks every pin into the free list and makes this the calling thread's pin set.
+     * All pins must have been released.
+     */
+    void reset() noexcept;
+
     /**
      * acquires a pin
      */
     static atm<void*>* acquire() noexcept
     {
         assert(isThreadRegistered());
-        assert(head != nullptr); // all pins acquired
 
+        auto pinSet = currentPinSet;
         auto value = head;
-        auto next = (atm<void*>*) value->load(orlx);
-        head = next;
+        head = untag(value->load(orlx));
+        if(unlikely(head == nullptr))
+            pinSet->grow(); //keeps head valid for the next acquire
+
+        //ordered before the pin's busySignal by its release, or by serializePinWriters()
+        pinSet->numAcquired.store(pinSet->numAcquired.load(orlx) + 1, orlx);
         return value;
     }
 
@@ -61,11 +106,48 @@ public:
     {
         assert(isThreadRegistered());
 
-        auto next = head;
-        value->store(next, orlx);
+        value->store(tag(head), orlx);
         head = value;
+
+        auto pinSet = currentPinSet;
+        pinSet->numAcquired.store(pinSet->numAcquired.load(orlx) - 1, orlx);
     }
 
+    /**
+     * Starts pinning a value that is about to be loaded from a shared location.
+     *
+     * The busySignal makes a scanner that reads the pin wait until endPin(),
+     * which prevents a race where the source object is destructed after being
+     * read but before being added to the pin set. The busySignal must be
+     * visible before the source is read: with asymmetric fences this is
+     * ensured by the scanner's serializePinWriters(), so that only the
+     * compiler needs to be kept from reordering here.
+     */
+    static void beginPin(atm<void*>* pin) noexcept
+    {
+        pin->store((void*) FRCConstants::busySignal, pinOrder);
+        if(FRCConstants::enableAsymmetricPinFences)
+            std::atomic_signal_fence(oseq);
+    }
+
+    static void endPin(atm<void*>* pin, void* value) noexcept
+    {
+        pin->store(value, pinOrder);
+    }
+
+    /**
+     * Registers the process for serializePinWriters(). Called once, before
+     * any thread registers.
+     */
+    static void registerPinWriters();
+
+    /**
+     * Issues a full memory barrier on every thread of the process, so that
+     * all pins begun before this call are visible to the caller. Does nothing
+     * unless asymmetric fences are enabled.
+     */
+    static void serializePinWriters() noexcept;
+
     static void setProtectedPointer(atm<void*>* value) noexcept
     {
         head = value;
@@ -76,15 +158,106 @@ public:
         return head;
     }
 
-    bool isValid(void* ptr) noexcept
+    /**
+     * Pins that are free, or that hold an object their PrivatePointer has made
+     * and not yet shared, need no protection.
+     */
+    static bool isValid(void* ptr) noexcept
     {
         return ptr != nullptr &&
-               ((sz) ptr < (sz) &protectedObjects[0] ||
-                (sz) ptr >= (sz) &protectedObjects[size]);
+               ((sz) ptr & (FRCConstants::ownedPinTag | FRCConstants::freePinTag)) == 0;
     }
 
-public:
-    std::unique_ptr<atm<void*>[]> protectedObjects;
+    /**
+     * Finds the pins of a group of scanGroupSize that need a scanner's
+     * attention: those that are valid, or busy. The rest (free, null, or
+     * owned pins) are skipped in bulk, as most pins in a block are free.
+     * @return a mask of the group's pins that need attention, which may
+     * include pins that have since changed
+     */
+    static uint findPinned(atm<void*> const* pins) noexcept
+    {
+        static_assert(FRCConstants::pinBlockSize % scanGroupSize == 0, "");
+        static_assert(FRCConstants::busySignal == FRCConstants::freePinTag, "");
+
+#if defined TERRAIN_X64 && defined TERRAIN_GCC && defined __SSE4_1__
+        /* Pins are loaded one at a time, as mutators store to them
+         * concurrently, and compared two to a vector. Valid pins have no tag
+         * bits and aren't null; busy pins equal their only tag bit.
+         */
+        auto const tagMask = _mm_set1_epi64x(FRCConstants::ownedPinTag | FRCConstants::freePinTag);
+        auto const busy = _mm_set1_epi64x(FRCConstants::busySignal);
+        auto const zero = _mm_setzero_si128();
+
+        uint mask = 0;
+        for(sz i = 0; i < scanGroupSize; i += 2)
+        {
+            auto v = _mm_set_epi64x((lng) pins[i + 1].load(orlx), (lng) pins[i].load(orlx));
+            auto untagged = _mm_cmpeq_epi64(_mm_and_si128(v, tagMask), zero);
+            auto valid = _mm_andnot_si128(_mm_cmpeq_epi64(v, zero), untagged);
+            auto needed = _mm_or_si128(valid, _mm_cmpeq_epi64(v, busy));
+            mask |= (uint) _mm_movemask_pd(_mm_castsi128_pd(needed)) << i;
+        }
+        std::atomic_thread_fence(oacq);
+        return mask;
+#else
+        uint mask = 0;
+        for(sz i = 0; i < scanGroupSize; ++i)
+        {
+            auto ptr = pins[i].load(orlx);
+            if(isValid(ptr) || ptr == (void*) FRCConstants::busySignal)
+                mask |= uint(1) << i;
+        }
+        return mask;
+#endif
+    }
+
+    /**
+     * @return whether the owner held no pins when last published
+     */
+    bool isEmpty() const noexcept
+    {
+        return numAcquired.load(oacq) == 0;
+    }
+
+    PinBlock* getFirstBlock() const noexcept
+    {
+        return first;
+    }
+
+    /**
+     * Blocks appended after this is read are not counted, but any pin taken
+     * from them is also taken after the read.
+     */
+    sz getNumBlocks() const noexcept
+    {
+        return numBlocks.load(oacq);
+    }
+
+private:
+
+    /**
+     * Appends a block and makes its pins the free list.
+     */
+    void grow();
+
+    void linkFree(PinBlock* block) noexcept;
+
+    static void* tag(atm<void*>* link) noexcept
+    {
+        return (void*)((sz) link | FRCConstants::freePinTag);
+    }
+
+    static atm<void*>* untag(void* link) noexcept
+    {
+        return (atm<void*>*)((sz) link & ~FRCConstants::freePinTag);
+    }
+
+private:
+    PinBlock* first;
+    PinBlock* last;
+    atm<sz> numBlocks;
+    atm<sz> numAcquired;
 };
 
 }
@@ -0,0 +1,242 @@
+/*
+ * File: PoolAllocator.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "PoolAllocator.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+tls(PoolThreadCache*, poolThreadCache);
+
+namespace
+{
+
+/**
+ * Orphans the calling thread's cache when the thread exits.
+ */
+struct PoolThreadCacheReleaser
+{
+    ~PoolThreadCacheReleaser()
+    {
+        if(poolThreadCache == nullptr)
+            return;
+
+        getPoolAllocator().releaseThreadCache(poolThreadCache);
+        poolThreadCache = nullptr;
+    }
+};
+
+} /* namespace */
+
+PoolThreadCache::PoolThreadCache() :
+    numPendingRemoteFrees(0),
+    numLive(0),
+    chunks(nullptr),
+    numRemoteFrees(0)
+{
+    for(auto& list : remoteFrees)
+        list.store(nullptr, orlx);
+}
+
+void* PoolThreadCache::allocateSlow(uint sizeClass)
+{
+    auto& sc = classes[sizeClass];
+
+    //reclaim blocks that other threads have freed back to us
+    if(remoteFrees[sizeClass].load(orlx) != nullptr)
+    {
+        auto block = remoteFrees[sizeClass].exchange(nullptr, oacq);
+        sc.freeList = block->next;
+        return block;
+    }
+
+    auto blockSize = PoolAllocator::getBlockSize(sizeClass);
+    if(sc.bump == sc.bumpEnd)
+    {
+        auto chunk = getPoolAllocator().allocateChunk(this, sizeClass);
+        sc.bump = (byte*) chunk + PoolChunk::headerSize;
+        sc.bumpEnd = sc.bump + ((PoolChunk::size - PoolChunk::headerSize) / blockSize) * blockSize;
+    }
+
+    auto block = sc.bump;
+    sc.bump += blockSize;
+    return block;
+}
+
+void PoolThreadCache::deallocateRemote(PoolFreeBlock* block, PoolChunk* chunk) noexcept
+{
+    auto owner = chunk->owner;
+    auto sizeClass = chunk->sizeClass;
+    auto index = (((uintptr_t) owner >> 6) ^ sizeClass) & (FRCConstants::numPoolRemoteBatches - 1);
+    auto& batch = remoteBatches[index];
+
+    if(batch.owner != owner || batch.sizeClass != sizeClass)
+    {
+        flushRemoteBatch(batch); //evict
+        batch.owner = owner;
+        batch.sizeClass = sizeClass;
+    }
+
+    block->next = batch.head;
+    batch.head = block;
+    if(batch.tail == nullptr)
+        batch.tail = block;
+    ++numPendingRemoteFrees;
+
+    if(++batch.count >= FRCConstants::poolRemoteBatchSize)
+        flushRemoteBatch(batch);
+}
+
+void PoolThreadCache::flushRemoteFrees() noexcept
+{
+    if(numPendingRemoteFrees == 0)
+        return;
+
+    for(auto& batch : remoteBatches)
+        flushRemoteBatch(batch);
+}
+
+void PoolThreadCache::flushRemoteBatch(RemoteBatch& batch) noexcept
+{
+    if(batch.head == nullptr)
+        return;
+
+    auto& list = batch.owner->remoteFrees[batch.sizeClass];
+    auto head = list.load(orlx);
+    do
+        batch.tail->next = head;
+    while(!list.compare_exchange_weak(head, batch.head, orls, orlx));
+
+    //last touch of the owner, which may be destroyed once its blocks are all counted
+    batch.owner->numRemoteFrees.fetch_add(batch.count, orls);
+
+    numPendingRemoteFrees -= batch.count;
+    batch.head = nullptr;
+    batch.tail = nullptr;
+    batch.count = 0;
+}
+
+PoolAllocator::PoolAllocator()
+{
+    ;
+}
+
+/**
+ * Runs after FRCManager's destructor (the manager constructs the allocator
+ * first), whose final collection has freed FRC's objects.
+ */
+PoolAllocator::~PoolAllocator()
+{
+    for(auto cache : caches)
+        destroyCache(cache);
+}
+
+PoolChunk* PoolAllocator::allocateChunk(PoolThreadCache* owner, uint sizeClass)
+{
+    void* mem = nullptr;
+    if(posix_memalign(&mem, PoolChunk::size, PoolChunk::size) != 0)
+        throw std::bad_alloc();
+
+    auto chunk = (PoolChunk*) mem;
+    chunk->owner = owner;
+    chunk->next = owner->chunks;
+    chunk->sizeClass = sizeClass;
+    owner->chunks = chunk;
+
+    if(debug) dout("PoolAllocator::allocateChunk() ", owner, " ", sizeClass, " ", chunk);
+    return chunk;
+}
+
+PoolThreadCache* PoolAllocator::acquireThreadCache()
+{
+    static thread_local PoolThreadCacheReleaser releaser;
+    (void) releaser;
+
+    PoolThreadCache* cache = nullptr;
+    {
+        auto lock = mutex.acquire();
+        if(!orphanedCaches.empty())
+        {
+            cache = orphanedCaches.back();
+            orphanedCaches.pop_back();
+        }
+    }
+
+    if(cache == nullptr)
+    {
+        cache = new PoolThreadCache;
+        auto lock = mutex.acquire();
+        caches.push_back(cache);
+    }
+
+    poolThreadCache = cache;
+    return cache;
+}
+
+void PoolAllocator::releaseThreadCache(PoolThreadCache* cache) noexcept
+{
+    cache->flushRemoteFrees();
+
+    auto lock = mutex.acquire();
+    orphanedCaches.push_back(cache);
+    releaseEmptyCachesLocked();
+}
+
+/**
+ * Returns the chunks of orphaned caches whose blocks have all been freed.
+ */
+void PoolAllocator::releaseEmptyCaches() noexcept
+{
+    auto lock = mutex.acquire();
+    releaseEmptyCachesLocked();
+}
+
+void PoolAllocator::releaseEmptyCachesLocked() noexcept
+{
+    for(sz i = 0; i < orphanedCaches.size();)
+    {
+        auto cache = orphanedCaches[i];
+        if(!cache->isEmpty())
+        {
+            ++i;
+            continue;
+        }
+
+        if(debug) dout("PoolAllocator::releaseEmptyCaches() ", cache);
+        orphanedCaches[i] = orphanedCaches.back();
+        orphanedCaches.pop_back();
+        caches.erase(std::find(caches.begin(), caches.end(), cache));
+        destroyCache(cache);
+    }
+}
+
+void PoolAllocator::destroyCache(PoolThreadCache* cache) noexcept
+{
+    while(cache->chunks != nullptr)
+    {
+        auto chunk = cache->chunks;
+        cache->chunks = chunk->next;
+        free(chunk);
+    }
+
+    delete cache;
+}
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
@@ -0,0 +1,284 @@
+/*
+ * File: PoolAllocator.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <util/util.h>
+#include <util/tls.h>
+#include <synchronization/MutexSpin.h>
+
+#include "FRCConstants.h"
+#include "MemoryBudget.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+class PoolAllocator;
+class PoolThreadCache;
+
+// We use a function to retrieve the allocator to avoid static initialization ordering issues
+PoolAllocator& getPoolAllocator(); //defined in FRCManager.cpp
+
+//this is left uninitialized for performance reasons
+extern tls(PoolThreadCache*, poolThreadCache);
+
+struct PoolFreeBlock
+{
+    PoolFreeBlock* next;
+};
+
+/**
+ * Header at the start of every pool chunk. Chunks are aligned to their size,
+ * so the chunk (and hence the size class and owner) of any pooled block is
+ * found by masking its address.
+ */
+struct PoolChunk
+{
+    static constexpr sz size = FRCConstants::poolChunkSize;
+    static constexpr sz headerSize = 64; //keeps blocks cache line aligned
+
+    PoolThreadCache* owner;
+    PoolChunk* next; //the owner's chunks
+    uint sizeClass;
+};
+
+/**
+ * Per-thread allocation state. Each size class has a private free list and bump
+ * region, plus a lock-free list that other threads push freed blocks onto.
+ *
+ * Blocks freed by a non-owning thread are first gathered in a small direct-mapped
+ * set of batches, and each batch is pushed to its owner with a single CAS.
+ *
+ * When a thread exits its cache is orphaned and handed to the next thread
+ * that needs one, since other threads may still hold (and later free) blocks
+ * from its chunks. An orphaned cache whose blocks have all been freed back is
+ * destroyed along with its chunks.
+ */
+class PoolThreadCache
+{
+private:
+    static constexpr bool debug = false;
+
+    friend class PoolAllocator;
+
+    struct SizeClass
+    {
+        PoolFreeBlock* freeList = nullptr;
+        byte* bump = nullptr;
+        byte* bumpEnd = nullptr;
+    };
+
+    struct RemoteBatch
+    {
+        PoolThreadCache* owner = nullptr;
+        uint sizeClass = 0;
+        sz count = 0;
+        PoolFreeBlock* head = nullptr;
+        PoolFreeBlock* tail = nullptr;
+    };
+
+public:
+
+    PoolThreadCache();
+
+    PoolThreadCache(PoolThreadCache const&) = delete;
+
+    PoolThreadCache(PoolThreadCache&&) = delete;
+
+    PoolThreadCache& operator=(PoolThreadCache const&) = delete;
+
+    PoolThreadCache& operator=(PoolThreadCache&&) = delete;
+
+    void* allocate(uint sizeClass)
+    {
+        ++numLive;
+        auto& sc = classes[sizeClass];
+        auto block = sc.freeList;
+        if(block == nullptr)
+            return allocateSlow(sizeClass);
+
+        sc.freeList = block->next;
+        return block;
+    }
+
+    void deallocate(void* ptr, PoolChunk* chunk) noexcept
+    {
+        auto block = (PoolFreeBlock*) ptr;
+        if(chunk->owner != this)
+        {
+            deallocateRemote(block, chunk);
+            return;
+        }
+
+        --numLive;
+        auto& sc = classes[chunk->sizeClass];
+        block->next = sc.freeList;
+        sc.freeList = block;
+    }
+
+    void flushRemoteFrees() noexcept;
+
+    /**
+     * @return true if every block allocated from this cache has been freed
+     * back to it. Only meaningful once the cache is orphaned.
+     */
+    bool isEmpty() const noexcept
+    {
+        return numLive == numRemoteFrees.load(oacq);
+    }
+
+private:
+
+    void* allocateSlow(uint sizeClass);
+
+    void deallocateRemote(PoolFreeBlock* block, PoolChunk* chunk) noexcept;
+
+    void flushRemoteBatch(RemoteBatch& batch) noexcept;
+
+private:
+    SizeClass classes[FRCConstants::numPoolSizeClasses];
+    RemoteBatch remoteBatches[FRCConstants::numPoolRemoteBatches];
+    sz numPendingRemoteFrees;
+    sz numLive; //blocks allocated, less those freed by the owner
+    PoolChunk* chunks;
+    cacheLinePadding p0;
+
+    atm<PoolFreeBlock*> remoteFrees[FRCConstants::numPoolSizeClasses]; //pushed by other threads
+    atm<sz> numRemoteFrees; //blocks pushed by other threads, counted after each push
+    cacheLinePadding p1;
+};
+
+/**
+ * Size-classed allocator used for all FRC objects and arrays when
+ * FRCConstants::enablePoolAllocator is set. Allocations larger than
+ * maxPooledAllocationSize, and all allocations when the pool is disabled,
+ * go straight to malloc/free.
+ *
+ * Deallocation is sized: callers pass the same size they allocated with.
+ */
+class PoolAllocator
+{
+private:
+    static constexpr bool debug = false;
+    static constexpr sz granularity = 16;
+
+public:
+
+    PoolAllocator();
+
+    PoolAllocator(PoolAllocator const&) = delete;
+
+    PoolAllocator(PoolAllocator&&) = delete;
+
+    PoolAllocator& operator=(PoolAllocator const&) = delete;
+
+    PoolAllocator& operator=(PoolAllocator&&) = delete;
+
+    ~PoolAllocator();
+
+    static void* allocate(sz size)
+    {
+        MemoryBudget::recordAllocation(size);
+        if(!isPooled(size))
+        {
+            auto mem = malloc(size);
+            if(mem == nullptr)
+                throw std::bad_alloc();
+            return mem;
+        }
+
+        return getThreadCache()->allocate(getSizeClass(size));
+    }
+
+    static void deallocate(void* ptr, sz size) noexcept
+    {
+        MemoryBudget::recordFree(size);
+        if(!isPooled(size))
+        {
+            free(ptr);
+            return;
+        }
+
+        getThreadCache()->deallocate(ptr, getChunk(ptr));
+    }
+
+    /**
+     * Pushes this thread's pending remote frees back to their owning threads.
+     */
+    static void flushRemoteFrees() noexcept
+    {
+        if(FRCConstants::enablePoolAllocator && poolThreadCache != nullptr)
+            poolThreadCache->flushRemoteFrees();
+    }
+
+    static constexpr bool isPooled(sz size) noexcept
+    {
+        return FRCConstants::enablePoolAllocator && size <= FRCConstants::maxPooledAllocationSize;
+    }
+
+    static constexpr uint getSizeClass(sz size) noexcept
+    {
+        return (uint)((std::max(size, (sz) 1) + granularity - 1) / granularity - 1);
+    }
+
+    static constexpr sz getBlockSize(uint sizeClass) noexcept
+    {
+        return (sizeClass + 1) * granularity;
+    }
+
+    static PoolChunk* getChunk(void* ptr) noexcept
+    {
+        return (PoolChunk*)((uintptr_t) ptr & ~(uintptr_t)(PoolChunk::size - 1));
+    }
+
+    PoolChunk* allocateChunk(PoolThreadCache* owner, uint sizeClass);
+
+    void releaseThreadCache(PoolThreadCache* cache) noexcept;
+
+    void releaseEmptyCaches() noexcept;
+
+private:
+
+    static PoolThreadCache* getThreadCache()
+    {
+        auto cache = poolThreadCache;
+        if(cache == nullptr)
+            cache = getPoolAllocator().acquireThreadCache();
+        return cache;
+    }
+
+    PoolThreadCache* acquireThreadCache();
+
+    void releaseEmptyCachesLocked() noexcept;
+
+    static void destroyCache(PoolThreadCache* cache) noexcept;
+
+private:
+    MutexSpin mutex;
+    std::vector<PoolThreadCache*> caches; //all of them, orphaned or not
+    std::vector<PoolThreadCache*> orphanedCaches;
+};
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
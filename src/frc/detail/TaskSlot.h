@@ -0,0 +1,239 @@
+/*
+ * File: TaskSlot.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include <util/util.h>
+#include <util/getticks.h>
+
+#include "FRCConstants.h"
+#include "LogSegment.h"
+
+namespace terrain
+{
+namespace frc
+{
+namespace detail
+{
+
+class ThreadData;
+
+/**
+ * A sweep block in progress, published so that other helpers can take it
+ * over when its helper is descheduled partway through: a step can't end
+ * until every block dequeued during it is done.
+ *
+ * The block is published by reference, as its place in the owner's log, and
+ * helpers claim its entries a chunk at a time. A helper that takes over a
+ * stalled block claims whatever is left and completes it, without waiting on
+ * chunks others have claimed: a stalled helper applies those late, which just
+ * delays their objects' reclamation. Until it has, the owner keeps the log
+ * segments the block is in (see ThreadData::numLateSweeps).
+ *
+ * Helpers join a block with a CAS on the state, and only touch the slot's
+ * fields once they have: the slot isn't republished until the block is done
+ * and every helper has left it.
+ */
+struct TaskSlot
+{
+    //state: generation, done, sweepers, size, entries claimed
+    static constexpr sz countBits = 12;
+    static constexpr sz countMask = (sz(1) << countBits) - 1;
+    static constexpr sz sweeper = sz(1) << (2 * countBits);
+    static constexpr sz sweeperMask = ((sz(1) << 16) - 1) * sweeper;
+    static constexpr sz doneBit = sz(1) << (2 * countBits + 16);
+    static constexpr sz generationShift = 2 * countBits + 17;
+
+    static_assert(FRCConstants::logBlockSize <= countMask, "");
+
+    atm<bool> busy; //from publication until the block is done and left
+    atm<sz> state;
+    atm<ticks> progress; //when the block was published, or a chunk of it last claimed
+    atm<ThreadData*> td;
+    atm<LogSegment*> segment; //holds the block's first entry
+    atm<sz> begin; //log position of the block's first entry
+    atm<sz> numApplied;
+    atm<bool> late; //completed by a takeover while others held claimed entries
+    cacheLinePadding padding;
+
+    TaskSlot() :
+        busy(false),
+        state(0),
+        progress(0),
+        td(nullptr),
+        segment(nullptr),
+        begin(0),
+        numApplied(0),
+        late(false)
+    {
+    }
+
+    bool tryAcquire() noexcept
+    {
+        return !busy.load(orlx) && !busy.exchange(true, oacq);
+    }
+
+    /**
+     * Publishes the decrements in [begin, end), held in segment and its
+     * successor, and joins the block.
+     * @return the state, as its first sweeper
+     */
+    sz publish(ThreadData* td_, LogSegment* segment_, sz begin_, sz end) noexcept
+    {
+        td.store(td_, orlx);
+        segment.store(segment_, orlx);
+        begin.store(begin_, orlx);
+        numApplied.store(0, orlx);
+        late.store(false, orlx);
+        auto s = (((state.load(orlx) >> generationShift) + 1) << generationShift) |
+                 sweeper | (end - begin_) << countBits;
+        progress.store(getticks(), orlx);
+        state.store(s, orls);
+        return s;
+    }
+
+    /**
+     * @return true if the block has been published for longer than
+     * taskStallTicks without progress
+     */
+    bool isStalled(ticks now) const noexcept
+    {
+        return busy.load(oacq) && (state.load(orlx) & doneBit) == 0 &&
+               now - progress.load(orlx) > FRCConstants::taskStallTicks;
+    }
+
+    static sz getSize(sz s) noexcept
+    {
+        return (s >> countBits) & countMask;
+    }
+
+    /**
+     * @return true if all of the block's entries are claimed
+     */
+    static bool isClaimed(sz s) noexcept
+    {
+        return (s & countMask) == getSize(s);
+    }
+
+    /**
+     * Joins the block published as s, unless it is done.
+     */
+    bool join(sz& s) noexcept
+    {
+        auto generation = s >> generationShift;
+        for(;;)
+        {
+            if(s >> generationShift != generation || (s & doneBit) != 0)
+                return false;
+            if(state.compare_exchange_weak(s, s + sweeper, oarl))
+            {
+                s += sweeper;
+                return true;
+            }
+        }
+    }
+
+    /**
+     * Claims the next chunk of up to chunkSize entries, [first, first + n),
+     * as a sweeper. s is the state last seen.
+     * @return false once all of the block's entries are claimed
+     */
+    bool claimEntries(sz& s, sz chunkSize, sz& first, sz& n) noexcept
+    {
+        for(;;)
+        {
+            if(isClaimed(s))
+                return false;
+
+            first = s & countMask;
+            n = std::min(chunkSize, getSize(s) - first);
+            if(state.compare_exchange_weak(s, s + n, oarl))
+            {
+                s += n;
+                progress.store(getticks(), orlx);
+                return true;
+            }
+        }
+    }
+
+    /**
+     * Calls apply(entries, count) on the claimed entries [first, first + n),
+     * in place in the log: once per segment they are in.
+     */
+    template<class Apply>
+    void applyEntries(sz first, sz n, Apply&& apply) const noexcept
+    {
+        auto seg = segment.load(orlx);
+        auto offset = (begin.load(orlx) & LogSegment::mask) + first;
+        if(offset >= LogSegment::size)
+        {
+            seg = seg->next;
+            offset -= LogSegment::size;
+        }
+
+        auto n0 = std::min(n, LogSegment::size - offset);
+        apply(&seg->entries[offset], n0);
+        if(n0 != n)
+            apply(&seg->next->entries[0], n - n0);
+    }
+
+    /**
+     * Counts n applied entries of a block of the given size.
+     * @return true if they were the last
+     */
+    bool applied(sz n, sz size) noexcept
+    {
+        return numApplied.fetch_add(n, oarl) + n == size;
+    }
+
+    /**
+     * @return true if every entry of a block of the given size has been applied
+     */
+    bool isApplied(sz size) const noexcept
+    {
+        return numApplied.load(oacq) == size;
+    }
+
+    /**
+     * Marks the block done, as a sweeper that has applied its last entries or
+     * claimed all that were left.
+     * @return true if this was the first to, and so completes the block
+     */
+    bool complete() noexcept
+    {
+        return (state.fetch_or(doneBit, oarl) & doneBit) == 0;
+    }
+
+    /**
+     * Leaves the block.
+     * @return true if this was the last sweeper to leave a done block, which
+     * must then free the slot
+     */
+    bool leave() noexcept
+    {
+        auto s = state.fetch_sub(sweeper, oarl) - sweeper;
+        return (s & (sweeperMask | doneBit)) == doneBit;
+    }
+
+    void free() noexcept
+    {
+        busy.store(false, orls);
+    }
+};
+
+} /* namespace detail */
+} /* namespace frc */
+} /* namespace terrain */
@@ -13,6 +13,8 @@
  */
 
 
+#include <algorithm>
+
 #include "ThreadData.h"
 #include "HelpRouter.h"
 
@@ -26,91 +28,555 @@ namespace detail
 
 tls(ScanFlag, scanFlag);
 
+atm<void (*)()> ThreadData::sweepClaimedHook(nullptr);
+atm<void (*)()> ThreadData::scanClaimedHook(nullptr);
+
 
 ThreadData::ThreadData() :
     decrementIndex(0),
     helpIndex(FRCConstants::baseHelpInterval),
-    decrementBuffer(new ObjectHeader * [FRCConstants::logBufferSize]),
+    logTail(getLogSegmentPool().acquire()),
+    logTailEnd(LogSegment::size),
     helping(false),
+    readSectionDepth(0),
+    helpPolicy(HelpPolicy::make(HelpPolicy::getDefaultType())),
+    helpDeadline(0),
+    emergencyHeapBytes(0),
+    spillSegment(nullptr),
+    spillSize(0),
     lastHelpIndex(0),
-    lastScanIndex(0),
+    readEpoch(0),
+    nextScanBlock(nullptr),
+    numQueuedScanBlocks(0),
     decrementConsumerIndex(0),
+    decrementSweepableIndex(0),
     decrementCaptureIndex(0),
-    decrementStackIndex(0),
-    decrementStackTarget(0),
+    idleSince(0),
+    decrementSweepTarget(0),
+    sweepSegment(logTail),
+    firstSegment(logTail),
+    numPendingPhases(0),
     numRemainingDecrementBlocks(-1),
-    numRemainingScanBlocks(numScanBlocks),
+    numRemainingScanBlocks(0),
+    numLateSweeps(0),
     detached(false),
     helpRouter(nullptr)
 {
     scanFlag.flag.store(false, orls);
-    decrementStack.reserve(FRCConstants::logSize);
 }
 
 ThreadData::~ThreadData()
 {
-    ;
+    auto& pool = getLogSegmentPool();
+
+    while(firstSegment != nullptr)
+    {
+        auto next = firstSegment->next;
+        pool.release(firstSegment);
+        firstSegment = next;
+    }
 }
 
-void ThreadData::help()
+/**
+ * Prepares a recycled ThreadData for use by the calling thread.
+ * Must only be called on a detached ThreadData whose work is complete.
+ */
+void ThreadData::reattach()
 {
-    decrementIndex &= FRCConstants::logMask; //wrap log index
+    assert(isReadyToDestruct());
+
+    pinSet.reset();
+    setHelpPolicy(HelpPolicy::getDefaultType());
+    scanFlag.flag.store(false, orls);
+    detached.store(false, orls);
     writeFence();
-    lastHelpIndex.store(decrementIndex, orls);
+}
 
-    //don't recursively help
-    if(helping)
+void ThreadData::help()
+{
+    auto status = getHelpStatus(); //before enterHelp() can move the tail past the recent entries
+    bool overflowing = status.logUsed > FRCConstants::maxLogSizeBeforeBlockingHelpCall;
+    if(FRCConstants::enableOverflowSpill)
     {
-        if(debug) dout("ThreadData::help() ", this, " recursive help ", helpIndex);
-        return;
+        if(overflowing)
+            spillDecrements(); //keeps the log from growing, without waiting on helpers
+        else if(spillSize != 0)
+            flushSpill();
     }
 
-    helpIndex = FRCConstants::logBufferSize;
-    helping = true;
-    //  for (;;)
-    //  {
-    if(decrementStackIndex + bufferSeparation(decrementCaptureIndex, decrementIndex)
-            <= FRCConstants::maxLogSizeBeforeBlockingHelpCall)
+    if(!enterHelp())
+        return;
+
+    auto pressure = MemoryBudget::getPressure();
+    MemoryBudget::report(pressure); //lets the application shed load
+
+    auto action = helpPolicy->beginHelp(status);
+    if(overflowing && !FRCConstants::enableOverflowSpill)
+        action = HelpAction::help; //whatever the policy, don't let the log overflow
+    else if(pressure != MemoryPressure::none && action == HelpAction::none)
+        action = HelpAction::tryHelp;
+
+    if(pressure != MemoryPressure::hard)
     {
-        helpRouter->tryHelp(this);
+        emergencyHeapBytes = 0;
     }
-    else
+    else if(MemoryBudget::getHeapBytes() > emergencyHeapBytes)
     {
-        helpRouter->help(this);
+        /* Over the hard limit, and the heap has grown since this thread last
+         * collected for it: the live objects alone may be over budget, and
+         * collecting again would not help.
+         */
+        helpRouter->emergencyCollect();
+        emergencyHeapBytes = MemoryBudget::getHeapBytes();
+        action = HelpAction::none;
     }
 
+    //only now, so the emergency collection above sweeps whole blocks
+    if(FRCConstants::helpBudgetTicks != 0)
+        helpDeadline = getticks() + FRCConstants::helpBudgetTicks;
+
+    if(action == HelpAction::help)
+        helpRouter->help(this);
+    else if(action == HelpAction::tryHelp)
+        helpRouter->tryHelp(this);
+
+    if(overflowing && FRCConstants::enableOverflowSpill)
+        helpRouter->tryHelpOverflow(); //drain spills at the rate they are made
 
-    //make help interval shrink as the buffer grows
-    auto helpInterval = FRCConstants::baseHelpInterval;
-    auto bufferUsed = bufferSeparation(decrementCaptureIndex, decrementIndex);
-    auto logUsed = decrementStackIndex + bufferUsed;
-    if(logUsed > FRCConstants::maxLogSizeBeforeHelpIntervalReduction)
+    auto helpInterval = helpPolicy->endHelp(getNumOutstandingDecrements());
+    if(pressure != MemoryPressure::none)
+        helpInterval = std::min(helpInterval, FRCConstants::memoryPressureHelpInterval);
+    exitHelp(helpInterval);
+}
+
+/**
+ * Moves the decrements logged since the last help call into the spill
+ * segment, and rewinds the log over them. Those a helper has published for
+ * this thread, as idle, stay in the log; the rest can't have been captured.
+ * The spill segment goes to the overflow queue once it holds a block, where
+ * any helper sweeps it once it has been scanned past.
+ */
+void ThreadData::spillDecrements()
+{
+    //a helper is capturing this log as idle: spill next time
+    auto publishLock = publishMutex.try_acquire();
+    if(!publishLock.owns_lock())
+        return;
+
+    auto begin = lastHelpIndex.load(orlx);
+    assert(begin + LogSegment::size >= logTailEnd); //since the last publish, the log has stayed in the tail
+
+    auto entries = &logTail->entries[begin & LogSegment::mask];
+    auto n = decrementIndex.load(orlx) - begin;
+    while(n != 0)
     {
-        /* Exponentially decrease help interval past this point to exert increasing
-         * back-pressure on log processing. Closed-loop feedback control.
-         */
+        if(spillSegment == nullptr)
+            spillSegment = getLogSegmentPool().acquire();
 
-        auto excessUsage = logUsed - FRCConstants::maxLogSizeBeforeHelpIntervalReduction;
-        auto excess = 1 + excessUsage / FRCConstants::helpIntervalReductionConstant;
-        helpInterval = std::max((sz)1, (sz)(helpInterval / excess));
+        auto m = std::min(n, LogSegment::size - spillSize);
+        std::copy(entries, entries + m, &spillSegment->entries[spillSize]);
+        spillSize += m;
+        entries += m;
+        n -= m;
+
+        if(spillSize == LogSegment::size)
+            flushSpill();
     }
 
-    //    if (helpInterval < 1)
-    //      continue;
+    //like the log, hold back at most a block in case this thread goes idle
+    if(spillSize >= FRCConstants::logBlockSize)
+        flushSpill();
+
+    decrementIndex.store(begin, orlx);
+}
 
-    assert(helpInterval < (FRCConstants::logBufferSize - bufferUsed)); // buffer overflow
-    helpIndex = std::min(FRCConstants::logBufferSize, decrementIndex + helpInterval);
+/**
+ * Hands the spill segment, if it holds anything, to the overflow queue. Owner only.
+ */
+void ThreadData::flushSpill()
+{
+    if(spillSegment == nullptr)
+        return;
+
+    if(spillSize != 0)
+        helpRouter->spill(spillSegment, spillSize);
+    else
+        getLogSegmentPool().release(spillSegment);
+
+    spillSegment = nullptr;
+    spillSize = 0;
+}
+
+/**
+ * Called in a loop by background collector threads.
+ * @return true if a task was processed
+ */
+bool ThreadData::collectorHelp()
+{
+    if(!enterHelp())
+        return false;
+
+    bool helped = helpRouter->tryHelp(this);
+    exitHelp(FRCConstants::baseHelpInterval);
+    return helped;
+}
+
+/**
+ * The recent entries are those logged since the last help call that are
+ * still in the tail segment.
+ */
+HelpStatus ThreadData::getHelpStatus() const noexcept
+{
+    auto tailStart = logTailEnd - LogSegment::size;
+    auto index = decrementIndex.load(orlx);
+    auto numRecent = std::min(index - lastHelpIndex.load(orlx), index - tailStart);
+
+    HelpStatus status;
+    status.logUsed = getNumOutstandingDecrements();
+    status.recent = logTail->entries + (index - tailStart - numRecent);
+    status.numRecent = numRecent;
+    status.hasCollectors = helpRouter->hasCollectors();
+    return status;
+}
+
+/**
+ * Publishes the log and guards against recursive helping.
+ * @return false if this thread is already helping
+ */
+bool ThreadData::enterHelp()
+{
+    auto index = decrementIndex.load(orlx);
+    if(index == logTailEnd)
+        growLog();
+    writeFence();
+    lastHelpIndex.store(index, orls);
+
+    //don't recursively help, nor from a read section, whose scan would wait on itself
+    helpIndex = logTailEnd;
+    if(helping || readSectionDepth != 0)
+    {
+        if(debug) dout("ThreadData::help() ", this, " recursive help ", helpIndex);
+        return false;
+    }
+
+    helping = true;
+    return true;
+}
+
+void ThreadData::exitHelp(sz helpInterval)
+{
+    //always stop at the end of the tail segment so the log can grow
+    helpIndex = std::min(logTailEnd, decrementIndex.load(orlx) + helpInterval);
+    helpDeadline = 0;
     helping = false;
 
-    if(debug) dout("ThreadData::help() ", this, "  ", helpInterval, " ", bufferUsed);
+    auto logUsed = getNumOutstandingDecrements();
+    if(debug) dout("ThreadData::help() ", this, "  ", helpInterval, " ", logUsed);
     if(debug && helpInterval <= 2)
         dout("ThreadData::help() ", this, "  ",
-             helpInterval, " ", decrementStackIndex, " ",
-             logUsed - decrementStackIndex, " ", logUsed);
-    //    break;
-    //  }
+             helpInterval, " ", decrementCaptureIndex - decrementConsumerIndex, " ",
+             decrementIndex.load(orlx) - decrementCaptureIndex, " ", logUsed);
+}
 
+/**
+ * Applies the decrements in [begin, end), held in segment and its successor.
+ * The block is published in a task slot, so other helpers can take over the
+ * rest of it should this one stall. If no slot is free, it is applied here:
+ * in chunks if the help call has a deadline, deferring the rest to other
+ * helpers once it passes, so one block of expensive destructors does not
+ * stall a mutator.
+ * @return true if this completed the epoch's sweep
+ */
+bool ThreadData::sweepRange(LogSegment* segment, sz begin, sz end) noexcept
+{
+    auto slot = begin != end ? helpRouter->acquireTaskSlot() : nullptr;
+    if(slot != nullptr)
+        return sweepClaimed(*slot, slot->publish(this, segment, begin, end), false) != nullptr;
+
+    auto deadline = threadData->helpDeadline; //the helper's, not this thread's
+    while(begin != end)
+    {
+        auto offset = begin & LogSegment::mask;
+        auto n = std::min(end - begin, LogSegment::size - offset);
+        if(deadline != 0)
+            n = std::min(n, FRCConstants::sweepChunkSize);
 
+        applyDecrements(&segment->entries[offset], n);
+        begin += n;
+        if(offset + n == LogSegment::size)
+            segment = segment->next;
+
+        if(deadline != 0 && begin != end && getticks() > deadline)
+        {
+            if(debug) dout("ThreadData::sweepRange() deferred ", this, " ", begin, "-", end);
+            helpRouter->deferSweep(this, segment, begin, end);
+            return false;
+        }
+    }
+
+    return completeSweepBlock();
+}
+
+/**
+ * Applies the entries of the sweep block published in slot, which this helper
+ * has joined as the given state, then leaves it. Entries are claimed in
+ * chunks if the help call has a deadline, deferring the rest once it passes.
+ * Taking over a stalled block claims the rest of it and completes it, leaving
+ * chunks other helpers claimed to them.
+ * @return the thread whose epoch's sweep this completed, or nullptr
+ */
+ThreadData* ThreadData::sweepClaimed(TaskSlot& slot, sz state, bool takeOver) noexcept
+{
+    auto deadline = takeOver ? 0 : threadData->helpDeadline; //the helper's
+    auto chunkSize = deadline != 0 ? FRCConstants::sweepChunkSize : FRCConstants::logBlockSize;
+    auto size = TaskSlot::getSize(state);
+    bool completing = false;
+
+    sz first, n;
+    while(!completing && slot.claimEntries(state, chunkSize, first, n))
+    {
+        if(auto hook = sweepClaimedHook.load(orlx))
+            hook();
+
+        slot.applyEntries(first, n, [](ObjectHeader* const* entries, sz count)
+        {
+            threadData->applyDecrements(entries, count);
+        });
+        completing = slot.applied(n, size);
+
+        if(!completing && deadline != 0 && !TaskSlot::isClaimed(state) && getticks() > deadline)
+        {
+            if(debug) dout("ThreadData::sweepClaimed() deferred ", &slot, " ", first + n, "/", size);
+            threadData->helpRouter->deferSweep(slot, state);
+            break;
+        }
+    }
+
+    ThreadData* completed = nullptr;
+    if((completing || takeOver) && slot.complete())
+    {
+        //still a sweeper: the slot can't be republished, so its fields are current
+        auto td = slot.td.load(orlx);
+        if(!slot.isApplied(size))
+        {
+            //taken over: the stalled helpers have yet to apply the chunks they claimed
+            td->numLateSweeps.fetch_add(1, orlx);
+            slot.late.store(true, orlx);
+        }
+
+        if(td->completeSweepBlock())
+            completed = td;
+    }
+
+    if(slot.leave())
+    {
+        if(slot.late.load(orlx))
+            slot.td.load(orlx)->numLateSweeps.fetch_sub(1, orls);
+        slot.free();
+    }
+
+    return completed;
+}
+
+/**
+ * Counts a swept block. The last block of the epoch's sweep queues the next one.
+ * @return true if this completed the epoch's sweep
+ */
+bool ThreadData::completeSweepBlock() noexcept
+{
+    //TODO: could possibly eliminate the last write here
+    if(numRemainingDecrementBlocks.fetch_sub(1, oarl) > 1)
+        return false;
+
+    //blocks taken over may still be read by their stalled helpers
+    if(numLateSweeps.load(oacq) == 0)
+        releaseSweptSegments();
+    auto numCarried = decrementSweepableIndex - decrementConsumerIndex;
+
+    //the previous capture has now been scanned, once this step completes
+    decrementSweepableIndex = decrementCaptureIndex;
+
+    //reset decrement capture index -- this captures the next group of decrements
+    captureDecrements();
+
+    /* Sweep all that became sweepable, and a few blocks of any backlog. Each
+     * epoch logs a protecting decrement per pinned object, so a smaller quota
+     * would fall ever further behind a thread holding many pins.
+     */
+    auto numSweepable = decrementSweepableIndex - decrementConsumerIndex;
+    auto quota = std::max(FRCConstants::logBlockSize * 4, numSweepable - numCarried);
+    decrementSweepTarget = decrementConsumerIndex + std::min(quota, numSweepable);
+    auto numSweepBlocks = (intt) ceilPositiveNoOverflow(
+                              decrementSweepTarget - decrementConsumerIndex,
+                              FRCConstants::logBlockSize);
+    numRemainingDecrementBlocks.store(numSweepBlocks, orlx);
+
+    if(debug)
+        dout("ThreadData::sweep() completed ", this, " ", decrementConsumerIndex, " ",
+             decrementSweepTarget,
+             " ", numSweepBlocks);
+
+    writeFence();
+    return true;
+}
+
+/**
+ * Applies n decrements read in place from a log segment.
+ * Repeated entries for the same header are combined in a small direct-mapped
+ * cache, so hot objects see one fetch_sub(n) per block instead of n contended
+ * fetch_sub(1) calls. Headers are prefetched ahead of the walk, and objects whose
+ * count reaches zero are destroyed afterwards in batches of the same type.
+ * Trivially destructible types skip their thunks and are freed directly.
+ */
+void ThreadData::applyDecrements(ObjectHeader* const* entries, sz n) noexcept
+{
+    assert(n <= FRCConstants::logBlockSize);
+
+    static constexpr sz cacheMask = FRCConstants::decrementCombiningCacheSize - 1;
+    ObjectHeader* headers[FRCConstants::decrementCombiningCacheSize] = {};
+    uint counts[FRCConstants::decrementCombiningCacheSize];
+
+    ObjectHeader* dead[FRCConstants::logBlockSize];
+    sz numDead = 0;
+
+    auto release = [&](ObjectHeader* h, uint n)
+    {
+        if(h->decrement(n))
+            dead[numDead++] = h;
+    };
+
+    for(sz i = 0; i < n; ++i)
+    {
+        if(i + FRCConstants::sweepPrefetchDistance < n)
+            __builtin_prefetch(entries[i + FRCConstants::sweepPrefetchDistance], 1);
+
+        auto h = entries[i];
+        if(debugExtra) dout("ThreadData::sweep() decrement ", this, " ", h);
+
+        auto slot = ((uintptr_t) h >> 4) & cacheMask;
+        if(headers[slot] == h)
+        {
+            ++counts[slot];
+            continue;
+        }
+
+        if(headers[slot] != nullptr)
+            release(headers[slot], counts[slot]); //evict
+
+        headers[slot] = h;
+        counts[slot] = 1;
+    }
+
+    for(sz slot = 0; slot <= cacheMask; ++slot)
+    {
+        if(headers[slot] != nullptr)
+            release(headers[slot], counts[slot]);
+    }
+
+    //run destructor thunks in per-type batches
+    std::sort(dead, dead + numDead, [](ObjectHeader* a, ObjectHeader* b)
+    {
+        return a->typeCode < b->typeCode;
+    });
+
+    for(sz first = 0; first < numDead;)
+    {
+        auto typeCode = dead[first]->typeCode;
+        auto last = first + 1;
+        while(last < numDead && dead[last]->typeCode == typeCode)
+            ++last;
+
+        if(DestructorMap::isTrivial(typeCode))
+        {
+            //nothing to destruct: free the whole run directly
+            for(auto i = first; i < last; ++i)
+                dead[i]->deallocate();
+        }
+        else
+        {
+            DestructorMap::callDestructors(dead + first, last - first, typeCode);
+        }
+
+        first = last;
+    }
+
+    PoolAllocator::flushRemoteFrees();
+}
+
+/**
+ * Chains a fresh segment onto the log. Must be called before the log position
+ * reaching the end of the tail is published, so helpers capturing up to that
+ * position always find a successor segment.
+ */
+void ThreadData::growLog()
+{
+    auto segment = getLogSegmentPool().acquire();
+    logTail->next = segment;
+    logTail = segment;
+    logTailEnd += LogSegment::size;
+}
+
+/**
+ * Captures the published decrements for sweeping. They stay in the log, and
+ * are swept in place.
+ */
+void ThreadData::captureDecrements()
+{
+    auto published = lastHelpIndex.load(oacq);
+    if(published != decrementCaptureIndex)
+        idleSince = 0;
+    else if(FRCConstants::idleCaptureTicks != 0)
+        published = captureIdleDecrements(published);
+
+    decrementCaptureIndex = published;
+}
+
+/**
+ * An owner only publishes its log when it helps, so one blocked on I/O could
+ * hold its last decrements indefinitely. Once a thread has published nothing
+ * for idleCaptureTicks, its log is published on its behalf: lastHelpIndex
+ * only moves forward, whether the owner or a helper moves it.
+ * @return the end of the published log
+ */
+sz ThreadData::captureIdleDecrements(sz published) noexcept
+{
+    auto now = getticks();
+    if(idleSince == 0)
+        idleSince = now;
+    if(now - idleSince < FRCConstants::idleCaptureTicks)
+        return published;
+
+    //the owner is spilling, so it isn't idle
+    auto publishLock = publishMutex.try_acquire();
+    if(!publishLock.owns_lock())
+        return published;
+
+    auto logged = decrementIndex.load(oacq);
+    if(logged != published && (logged & LogSegment::mask) == 0)
+        --logged; //the owner chains the next segment when it publishes the end of this one
+    if(logged == published)
+        return published;
+
+    if(debug) dout("ThreadData::captureIdleDecrements() ", this, " ", published, "-", logged);
+    if(lastHelpIndex.compare_exchange_strong(published, logged, oarl))
+        published = logged;
+
+    idleSince = 0;
+    return published;
+}
+
+/**
+ * Returns the log segments this epoch's sweep has passed to the pool.
+ */
+void ThreadData::releaseSweptSegments() noexcept
+{
+    auto& pool = getLogSegmentPool();
+    while(firstSegment != sweepSegment)
+    {
+        auto next = firstSegment->next;
+        pool.release(firstSegment);
+        firstSegment = next;
+    }
 }
 
 }
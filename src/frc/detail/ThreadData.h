@@ -15,11 +15,16 @@
 #pragma once
 
 #include <assert.h>
+#include <thread>
 #include <vector>
 #include <util/tls.h>
+#include <util/getticks.h>
 #include <synchronization/MutexSpin.h>
 #include "ObjectHeader.h"
+#include "LogSegment.h"
 #include "PinSet.h"
+#include "HelpPolicy.h"
+#include "TaskSlot.h"
 
 namespace terrain
 {
@@ -104,9 +109,10 @@ public:
 
     void logDecrement(ObjectHeader* header) noexcept
     {
-        decrementBuffer[decrementIndex] = header;
-        ++decrementIndex;
-        if(decrementIndex == helpIndex)
+        auto index = decrementIndex.load(orlx);
+        logTail->entries[index & LogSegment::mask] = header;
+        decrementIndex.store(++index, orls); //helpers may capture the entry from an idle log
+        if(index == helpIndex)
             help();
     }
 
@@ -120,23 +126,82 @@ public:
 
     void help();
 
+    bool collectorHelp();
+
+    bool sweepRange(LogSegment* segment, sz begin, sz end) noexcept;
+
+    static ThreadData* sweepClaimed(TaskSlot& slot, sz state, bool takeOver) noexcept;
+
+    //tests only: called as a helper claims entries of a published sweep block
+    static atm<void (*)()> sweepClaimedHook;
+
+    //tests and benchmarks only: called as a helper dequeues a scan block
+    static atm<void (*)()> scanClaimedHook;
+
+    void applyDecrements(ObjectHeader* const* entries, sz n) noexcept;
+
+    void flushSpill();
+
+    /**
+     * @return when this thread's current help call should return, or 0 if it is unbudgeted
+     */
+    ticks getHelpDeadline() const noexcept
+    {
+        return helpDeadline;
+    }
+
+    /**
+     * Replaces this thread's help policy. Owner only.
+     */
+    void setHelpPolicy(HelpPolicyType type)
+    {
+        helpPolicy = HelpPolicy::make(type);
+    }
+
+    /**
+     * Number of decrements that have been logged but not yet processed.
+     * Only meaningful on the owning thread; helpers may race with it.
+     */
+    sz getNumOutstandingDecrements() const noexcept
+    {
+        return decrementIndex.load(orlx) - decrementConsumerIndex;
+    }
+
     void detach()
     {
-        lastHelpIndex = decrementIndex;
+        flushSpill();
+        lastHelpIndex.store(decrementIndex.load(orlx), oseq);
         detached.store(true, orls);
         writeFence();
     }
 
+    void reattach();
+
     bool isReadyToDestruct()
     {
-        return allWorkComplete() && detached.load(oacq);
+        return allWorkComplete() && detached.load(oacq) && numLateSweeps.load(oacq) == 0;
     }
 
     bool allWorkComplete()
     {
-        return decrementStack.size() == 0 &&
-               decrementStackIndex == 0 &&
-               decrementIndex == decrementCaptureIndex;
+        return decrementConsumerIndex == decrementCaptureIndex &&
+               decrementIndex.load(oacq) == decrementCaptureIndex;
+    }
+
+    /**
+     * Read sections nest; only the outermost one is announced to scanners.
+     * An odd readEpoch means the owner is inside one.
+     */
+    void enterReadSection() noexcept
+    {
+        if(readSectionDepth++ == 0)
+            readEpoch.fetch_add(1, oseq); //the section's loads must not pass the announcement
+    }
+
+    void exitReadSection() noexcept
+    {
+        if(--readSectionDepth == 0)
+            readEpoch.store(readEpoch.load(orlx) + 1, orls);
     }
 
     static void waitForScan()
@@ -155,7 +220,7 @@ public:
 
     void protect(void* ptr)
     {
-        if(!pinSet.isValid(ptr))
+        if(!PinSet::isValid(ptr))
             return;
 
         auto header = getObjectHeader(ptr);
@@ -165,145 +230,187 @@ public:
     }
 
 private:
-    static constexpr auto numScanBlocks =
-        (uint)(FRCConstants::pinSetSize / FRCConstants::protectedBlockSize);
 
+    /**
+     * Scans one block of the pin set. Each step scans the blocks the set had
+     * at the step's first scan task, which comes after every capture the
+     * scan protects. A set that is empty when scanned is skipped: pins
+     * acquired since were acquired after those captures.
+     */
     template<class PostDequeueHandler>
     bool scan(PostDequeueHandler&& postDequeueHandler)
     {
         if(debug) dout("ThreadData::scan() ", this);
         readFence();
 
-        auto begin = lastScanIndex;
-        auto end = begin + FRCConstants::protectedBlockSize;
-        lastScanIndex = end;
-        postDequeueHandler(lastScanIndex >= FRCConstants::pinSetSize);
+        if(nextScanBlock == nullptr)
+            queueScanBlocks();
+
+        auto block = nextScanBlock;
+        nextScanBlock = block->next.load(oacq);
+        if(--numQueuedScanBlocks == 0)
+            nextScanBlock = nullptr; //queue the next step's scans on its first task
+        postDequeueHandler(nextScanBlock == nullptr);
+
+        if(debug) dout("ThreadData::scan() success ", this, " ", block);
+        auto protectedPtrs = block->pins;
 
-        if(debug) dout("ThreadData::scan() success ", this, " ", begin, "-", end);
-        auto protectedPtrs = this->pinSet.protectedObjects.get();
+        //a scan can't be taken over, see HelpRouter::tryHelpStalled()
+        if(auto hook = scanClaimedHook.load(orlx))
+            hook();
 
+        if(block == pinSet.getFirstBlock())
+            waitForReadSection();
+
+        if(!pinSet.isEmpty())
         {
             scanFlag.flag.store(true, orls);
-            for(auto i = begin; i < end; ++i)
+            for(sz i = 0; i < FRCConstants::pinBlockSize; i += PinSet::scanGroupSize)
             {
-                void* ptr;
+                for(auto mask = PinSet::findPinned(&protectedPtrs[i]); mask != 0; mask &= mask - 1)
+                {
+                    auto& pin = protectedPtrs[i + countTrailingZeros(mask)];
+                    void* ptr;
 
-                do
-                    ptr = protectedPtrs[i].load(oacq);
-                while(ptr == (void*) FRCConstants::busySignal);
+                    do
+                        ptr = pin.load(oacq);
+                    while(ptr == (void*) FRCConstants::busySignal);
 
-                protect(ptr);
+                    protect(ptr);
+                }
             }
             scanFlag.flag.store(false, orls);
         }
-        if(debug) dout("ThreadData::scan() done ", this, " ", begin, "-", end);
+        if(debug) dout("ThreadData::scan() done ", this, " ", block);
         //writeFence();
 
         //TODO: could possibly eliminate the last write here
         if(numRemainingScanBlocks.fetch_sub(1, oarl) > 1)
             return false;
 
-        if(debug) dout("ThreadData::scan() completed ", this, " ", begin, "-", end);
+        if(debug) dout("ThreadData::scan() completed ", this, " ", block);
         return true;
     }
 
+    /**
+     * Raw pointers loaded in a read section are not pinned, so a section the
+     * owner is in now must end before this epoch's sweep. Sections that begin
+     * after this point can only reach objects that are still counted.
+     */
+    void waitForReadSection() noexcept
+    {
+        fence();
+        auto epoch = readEpoch.load(oacq);
+        if((epoch & 1) == 0)
+            return;
+
+        auto sectionEnded = [&]()
+        {
+            return readEpoch.load(oacq) != epoch;
+        };
+
+        //the reader may have been preempted: back off, then yield to it
+        if(Spinner::spin(sectionEnded, 1024 * 128))
+            return;
+
+        while(!sectionEnded())
+            std::this_thread::yield();
+    }
+
+    /**
+     * Sweeps one block of captured decrements, read in place from the log.
+     * A block may straddle two segments; the owner chains each successor
+     * before publishing the end of its predecessor.
+     *
+     * Decrements captured at the end of a step's sweep are swept two steps
+     * later: a step's scans run alongside its sweeps, so only the following
+     * step's scans are sure to start after the capture.
+     */
     template<class PostDequeueHandler>
     bool sweep(PostDequeueHandler&& postDequeueHandler)
     {
         readFence();
         if(debug) dout("ThreadData::sweep() ", this);
-        auto blockSize = std::min(FRCConstants::logBlockSize,
-                                  decrementStackIndex - decrementStackTarget);
-        auto begin = decrementStackIndex;
-        decrementStackIndex -= blockSize;
-        postDequeueHandler(decrementStackIndex <= decrementStackTarget);
+        auto begin = decrementConsumerIndex;
+        auto end = std::min(begin + FRCConstants::logBlockSize, decrementSweepTarget);
+        auto segment = sweepSegment;
+        auto offset = begin & LogSegment::mask;
+        if(offset + std::min(end - begin, LogSegment::size - offset) == LogSegment::size)
+            sweepSegment = segment->next;
+        decrementConsumerIndex = end;
+        postDequeueHandler(end == decrementSweepTarget);
 
         //success: dequeued a block
-        if(debug) dout("ThreadData::sweep() success ", this, " ", begin, "-", blockSize);
-
-        for(sz i = 0; i < blockSize; ++i)
-        {
-            auto h = decrementStack[begin - 1 - i];
-            if(debugExtra) dout("ThreadData::sweep() decrement ", this, " ", h);
-            h->decrementAndDestroy();
-        }
+        if(debug) dout("ThreadData::sweep() success ", this, " ", begin, "-", end);
 
-        //TODO: could possibly eliminate the last write here
-        if(numRemainingDecrementBlocks.fetch_sub(1, oarl) > 1)
-            return false;
+        return sweepRange(segment, begin, end);
+    }
 
-        decrementStack.resize(decrementStackIndex);
+    void queueScanBlocks() noexcept
+    {
+        nextScanBlock = pinSet.getFirstBlock();
+        numQueuedScanBlocks = (uint) pinSet.getNumBlocks();
+        numRemainingScanBlocks.store(numQueuedScanBlocks, orls);
+    }
 
-        //reset decrement capture index -- this captures the next group of decrements
 
+    bool completeSweepBlock() noexcept;
 
-        auto from = decrementCaptureIndex;
-        auto to = lastHelpIndex.load(oacq);
-        for(sz i = from; i != to; i = (i + 1) & FRCConstants::logMask)
-        {
-            decrementStack.push_back(decrementBuffer[i]);
-        }
+    void spillDecrements();
 
-        decrementCaptureIndex = to;
+    HelpStatus getHelpStatus() const noexcept;
 
-        decrementStackIndex = decrementStack.size();
-        decrementStackTarget = decrementStackIndex - std::min(FRCConstants::logBlockSize * 4,
-                               decrementStackIndex);
-        auto numSweepBlocks = (intt) ceilPositiveNoOverflow(
-                                  decrementStackIndex - decrementStackTarget,
-                                  FRCConstants::logBlockSize);
-        numRemainingDecrementBlocks.store(numSweepBlocks, orlx);
+    bool enterHelp();
 
-        //reset scan vars
-        lastScanIndex = 0;
-        numRemainingScanBlocks.store(numScanBlocks, orls);
+    void exitHelp(sz helpInterval);
 
-        if(debug)
-            dout("ThreadData::sweep() completed ", this, " ", decrementStackIndex, " ",
-                 decrementStackTarget,
-                 " ", numSweepBlocks);
+    void growLog();
 
-        //    if (decrementStackIndex > 20000 )//|| numSweepBlocks > 1)
-        //      dout(this, " ", decrementStackIndex, " ",
-        //           decrementStackTarget,
-        //           " ", numSweepBlocks);
+    void captureDecrements();
 
-        writeFence();
-        return true;
-    }
+    sz captureIdleDecrements(sz published) noexcept;
 
-    sz bufferSeparation(sz from, sz to)
-    {
-        return (from <= to) ?
-               (to - from) :
-               (to + (FRCConstants::logBufferSize - from));
-    }
+    void releaseSweptSegments() noexcept;
 
 private:
 
-    sz decrementIndex;
+    atm<sz> decrementIndex; //monotonic log position, read by helpers capturing an idle log
     sz helpIndex;
-    std::unique_ptr<ObjectHeader *[]> decrementBuffer;
-    std::vector<ObjectHeader*> decrementStack;
+    LogSegment* logTail; //segment holding decrementIndex
+    sz logTailEnd; //log position one past the end of logTail
     PinSet pinSet;
     bool helping;
+    uint readSectionDepth;
+    std::unique_ptr<HelpPolicy> helpPolicy;
+    ticks helpDeadline; //0: no budget
+    sz emergencyHeapBytes; //heap bytes after this thread's last emergency collection
+    LogSegment* spillSegment; //decrements moved out of an overflowing log
+    sz spillSize;
     cacheLinePadding padding0;
 
     atm<sz> lastHelpIndex;
-    sz lastScanIndex; //queues scan tasks
+    MutexSpin publishMutex; //keeps idle captures out of a spill's rewind
+    atm<sz> readEpoch; //odd while in a read section
+    PinBlock* nextScanBlock; //queues scan tasks
+    uint numQueuedScanBlocks;
     sz decrementConsumerIndex; //dequeues sweep tasks
-    sz decrementCaptureIndex; //queues sweep tasks
-    sz decrementStackIndex;
-    sz decrementStackTarget;
+    sz decrementSweepableIndex; //end of the scanned captures
+    sz decrementCaptureIndex; //end of the captures awaiting a scan
+    ticks idleSince; //when a capture first found nothing newly published; 0: not idle
+    sz decrementSweepTarget; //end of this epoch's sweep tasks
+    LogSegment* sweepSegment; //segment holding decrementConsumerIndex
+    LogSegment* firstSegment; //oldest segment not yet swept through
 
 public:
-    uint lastPhaseDispatched;
-    uint subqueue;
+    uint lastStepDispatched[2]; //per phase
+    uint subqueue[2]; //per phase
+    atm<uint> numPendingPhases; //of the current step
 private:
     cacheLinePadding padding2;
 
     atm<intt> numRemainingDecrementBlocks;
     atm<uint> numRemainingScanBlocks;
+    atm<sz> numLateSweeps; //blocks taken over whose stalled helpers still read this log
     cacheLinePadding padding3;
 
     atm<bool> detached;
@@ -19,6 +19,9 @@
 #include "AtomicPointer.h"
 #include "SharedPointer.h"
 #include "PrivatePointer.h"
+#include "MarkedAtomicPointer.h"
+#include "MultiCas.h"
+#include "ReadSection.h"
 
 namespace terrain
 {
@@ -40,6 +43,57 @@ inline static bool isThreadRegistered()
     return detail::FRCManager::isThreadRegistered();
 }
 
+/**
+ * Starts background collector threads, which take over most scan and sweep work
+ * from mutator threads. Does nothing if collectors are already running.
+ */
+inline static void startCollectors(sz numCollectors)
+{
+    detail::FRCManager::startCollectors(numCollectors);
+}
+
+/**
+ * Stops and joins any background collector threads.
+ */
+inline static void stopCollectors()
+{
+    detail::FRCManager::stopCollectors();
+}
+
+using HelpPolicyType = detail::HelpPolicyType;
+
+/**
+ * Chooses how much collection work mutators do inline (see detail/HelpPolicy.h).
+ * Applies to the calling thread and to threads that register afterwards.
+ */
+inline static void setHelpPolicy(HelpPolicyType type)
+{
+    detail::FRCManager::setHelpPolicy(type);
+}
+
+using MemoryPressure = detail::MemoryPressure;
+
+/**
+ * Bounds the memory held by FRC objects, live or awaiting reclamation: past
+ * softLimit bytes mutators help more often, and past hardLimit they collect
+ * synchronously. The callback, if any, is told each change of pressure so
+ * the application can shed load; it runs on a mutator thread, and should be
+ * quick. Limits of 0 disable them.
+ */
+inline static void setMemoryBudget(sz softLimit, sz hardLimit,
+                                   detail::MemoryBudget::Callback callback = nullptr)
+{
+    detail::FRCManager::setMemoryBudget(softLimit, hardLimit, std::move(callback));
+}
+
+/**
+ * @return the bytes held by FRC objects, to within a few hundred KB per thread
+ */
+inline static sz getHeapBytes()
+{
+    return detail::MemoryBudget::getHeapBytes();
+}
+
 /**
  * A wrapper class for use when entering and exiting FRC code.
  * Just stack allocate a FRCToken, which will register the thread.
@@ -69,7 +123,7 @@ template<class T, class ... Args>
 auto make_atomic(Args&& ... args)
 {
     ap<T> result;
-    result.makeProtected(std::forward<Args>(args) ...);
+    result.make(std::forward<Args>(args) ...);
     return result;
 }
 
@@ -227,7 +227,7 @@ typedef unsigned long long ticks;
 static __inline__ ticks getticks(void)
 {
     unsigned a, d;
-    asm("rdtsc" : "=a"(a), "=d"(d));
+    __asm__ __volatile__("rdtsc" : "=a"(a), "=d"(d)); //volatile: successive reads must not be merged
     return ((ticks) a) | (((ticks) d) << 32);
 }
 
@@ -0,0 +1,145 @@
+/*
+ * File: AtomicPointer_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <thread>
+#include <vector>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+struct Counter : Live
+{
+    lng value;
+
+    explicit Counter(lng value) : value(value)
+    {
+    }
+};
+
+} /* namespace */
+
+TEST(frcAtomicPointer, compare_exchange)
+{
+    {
+        FRCToken token;
+        AtomicPointer<Counter> shared(0);
+
+        PrivatePointer<Counter> expected(shared);
+        PrivatePointer<Counter> desired(1);
+        ASSERT_TRUE(shared.compare_exchange_strong(expected, desired));
+        ASSERT_EQ(shared->value, 1);
+
+        //expected is stale now: the CAS must fail and re-pin the current value
+        PrivatePointer<Counter> other(2);
+        ASSERT_FALSE(shared.compare_exchange_strong(expected, other));
+        ASSERT_EQ(expected.get(), shared.get());
+        ASSERT_EQ(expected->value, 1);
+
+        Counter* raw = desired.get();
+        ASSERT_TRUE(shared.compare_exchange_strong(raw, nullptr));
+        ASSERT_EQ(shared.get(), nullptr);
+
+        raw = nullptr;
+        SharedPointer<Counter> sharedDesired(3);
+        ASSERT_TRUE(shared.compare_exchange_strong(raw, sharedDesired));
+        ASSERT_EQ(shared->value, 3);
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
+
+/**
+ * Moving a freshly made PrivatePointer into an AtomicPointer or SharedPointer hands
+ * over the creation count, so no increment is taken; copying still takes one.
+ */
+TEST(frcAtomicPointer, move_publish)
+{
+    {
+        FRCToken token;
+        PrivatePointer<Counter> made;
+        made.make(1);
+        ASSERT_EQ(made.use_count(), 1u);
+
+        AtomicPointer<Counter> moved(std::move(made));
+        ASSERT_EQ(moved.use_count(), 1u);
+
+        PrivatePointer<Counter> copied;
+        copied.make(2);
+        AtomicPointer<Counter> copy(copied);
+        ASSERT_EQ(copy.use_count(), 2u);
+
+        copied.make(3);
+        SharedPointer<Counter> shared;
+        shared = std::move(copied);
+        ASSERT_EQ(shared.use_count(), 1u);
+        ASSERT_EQ(shared->value, 3);
+
+        //a made object that is never published is released with its pointer
+        PrivatePointer<Counter> dropped;
+        dropped.make(4);
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
+
+/**
+ * Concurrent RCU-style increments must neither lose updates nor leak the
+ * replaced (or failed) values.
+ */
+TEST(frcAtomicPointer, update)
+{
+    static constexpr lng numIncrements = 20000;
+    sz numThreads = std::max(sz(4), (sz) hardwareConcurrency());
+
+    {
+        FRCToken token;
+        AtomicPointer<Counter> shared(0);
+        std::vector<std::thread> threads;
+
+        for(sz t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                FRCToken tkn;
+                for(lng i = 0; i < numIncrements; ++i)
+                {
+                    shared.update([](PrivatePointer<Counter> const& current)
+                    {
+                        return PrivatePointer<Counter>(current->value + 1);
+                    });
+                }
+            });
+        }
+
+        for(auto& thread : threads)
+            thread.join();
+
+        ASSERT_EQ(shared->value, (lng) numThreads * numIncrements);
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
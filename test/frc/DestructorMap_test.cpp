@@ -0,0 +1,118 @@
+/*
+ * File: DestructorMap_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <frc/frc.h>
+#include <util/FastRNG.h>
+
+using namespace terrain;
+using namespace terrain::frc;
+
+namespace
+{
+
+static constexpr sz numTypes = 64;
+
+atm<sz> numDestroyed(0);
+
+template<sz N>
+struct Tagged
+{
+    sz value;
+
+    explicit Tagged(sz value) : value(value)
+    {
+        ;
+    }
+
+    ~Tagged()
+    {
+        EXPECT_EQ(value, N);
+        numDestroyed.fetch_add(1, oarl);
+    }
+};
+
+template<sz N>
+uint useType()
+{
+    PrivatePointer<Tagged<N>> object;
+    object.make(N);
+    return frc::detail::DestructorMap::getTypeCode<Tagged<N>>();
+}
+
+template<sz ... N>
+std::vector<uint(*)()> makeUses(std::index_sequence<N...>)
+{
+    return {&useType<N>...};
+}
+
+} /* namespace */
+
+/**
+ * Threads race to be the first to use each of a set of fresh types, in different
+ * orders. Every thread must see the same code for a type, codes must be distinct
+ * across types, and every object must be destroyed by its own type's thunk.
+ */
+TEST(frcDestructorMap, concurrent_first_use)
+{
+    auto uses = makeUses(std::make_index_sequence<numTypes>());
+    sz numThreads = std::max(sz(4), (sz) hardwareConcurrency());
+    std::vector<std::vector<uint>> codes(numThreads, std::vector<uint>(numTypes));
+    std::vector<std::thread> threads;
+    atm<bool> go(false);
+
+    for(sz t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&](sz t2)
+        {
+            FRCToken token;
+            while(!go.load(oacq))
+                ;
+
+            for(sz i = 0; i < numTypes; ++i)
+            {
+                auto type = (i * (2 * t2 + 1)) % numTypes; //odd stride: a permutation per thread
+                codes[t2][type] = uses[type]();
+            }
+        }, t);
+    }
+
+    go.store(true, orls);
+    for(auto& thread : threads)
+        thread.join();
+
+    {
+        FRCToken token;
+        frc::detail::FRCManager::collect();
+    }
+
+    std::set<uint> distinct;
+    for(sz type = 0; type < numTypes; ++type)
+    {
+        ASSERT_NE(codes[0][type], 0u);
+        ASSERT_EQ(codes[0][type] & 1, 0u);
+        for(sz t = 1; t < numThreads; ++t)
+            ASSERT_EQ(codes[t][type], codes[0][type]);
+        distinct.insert(codes[0][type]);
+    }
+
+    ASSERT_EQ(distinct.size(), numTypes);
+    ASSERT_EQ(numDestroyed.load(oacq), numThreads * numTypes);
+}
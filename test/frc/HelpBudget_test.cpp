@@ -0,0 +1,100 @@
+/*
+ * File: HelpBudget_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+static constexpr lng alive = 0x5ca1ab1e;
+
+/**
+ * Slow enough to destroy that a budgeted help call runs out of time partway
+ * through a sweep block, and defers the rest.
+ */
+struct Slow : Live
+{
+    atm<lng> state;
+    AtomicPointer<Slow> child;
+
+    Slow()
+    {
+        state.store(alive, orls);
+    }
+
+    ~Slow()
+    {
+        EXPECT_EQ(state.load(oacq), alive);
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(20);
+        while(std::chrono::steady_clock::now() < until)
+            ;
+
+        state.store(0, orls);
+    }
+};
+
+} /* namespace */
+
+/**
+ * A help call that would sweep a block of Slow objects runs out of its budget
+ * and defers the rest of the block. Every object, and the child its
+ * destructor releases, is still destroyed exactly once.
+ */
+TEST(frcHelpBudget, deferred_sweeps)
+{
+    static constexpr lng numIters = 3000;
+    sz numThreads = std::max(sz(4), (sz) hardwareConcurrency());
+    auto numDeferredBefore = frc::detail::FRCManager::getNumSweepsDeferred();
+
+    {
+        std::vector<std::thread> threads;
+        for(sz t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                FRCToken tkn;
+                AtomicPointer<Slow> slot;
+                for(lng i = 0; i < numIters; ++i)
+                {
+                    slot.make();
+                    slot->child.make();
+                }
+            });
+        }
+
+        for(auto& thread : threads)
+            thread.join();
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+
+    auto numDeferred = frc::detail::FRCManager::getNumSweepsDeferred() - numDeferredBefore;
+    if(frc::detail::FRCConstants::helpBudgetTicks != 0)
+        EXPECT_GT(numDeferred, sz(0));
+    else
+        EXPECT_EQ(numDeferred, sz(0));
+}
@@ -0,0 +1,179 @@
+/*
+ * File: HelpPolicy_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+using frc::detail::FRCConstants;
+using frc::detail::HelpAction;
+using frc::detail::HelpStatus;
+using frc::detail::ObjectHeader;
+
+namespace
+{
+
+/**
+ * Large enough that the bytes-in-flight policy passes its target long before
+ * the log fills.
+ */
+struct Bulky : Live
+{
+    lng values[128];
+};
+
+/**
+ * Every thread keeps replacing the object in its own slot; all of it must be
+ * reclaimed, whichever policy paces the help calls.
+ */
+void churn(HelpPolicyType type)
+{
+    static constexpr lng numIters = 100000;
+    sz numThreads = std::max(sz(4), (sz) hardwareConcurrency());
+
+    setHelpPolicy(type);
+    {
+        std::vector<std::thread> threads;
+        for(sz t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                FRCToken tkn;
+                AtomicPointer<Bulky> slot;
+                for(lng i = 0; i < numIters; ++i)
+                    slot.make();
+            });
+        }
+
+        for(auto& thread : threads)
+            thread.join();
+    }
+    setHelpPolicy(frc::detail::FRCConstants::defaultHelpPolicy);
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
+
+HelpStatus makeStatus(sz logUsed, bool hasCollectors, ObjectHeader* const* recent = nullptr,
+                      sz numRecent = 0)
+{
+    return HelpStatus{logUsed, recent, numRecent, hasCollectors};
+}
+
+//far enough past maxLogSizeBeforeHelpIntervalReduction to quarter the help interval
+static constexpr sz backedUpLogSize = FRCConstants::maxLogSizeBeforeHelpIntervalReduction +
+                                      sz(3 * FRCConstants::helpIntervalReductionConstant);
+
+} /* namespace */
+
+TEST(frcHelpPolicy, log_size)
+{
+    churn(HelpPolicyType::logSize);
+}
+
+TEST(frcHelpPolicy, bytes_in_flight)
+{
+    churn(HelpPolicyType::bytesInFlight);
+}
+
+TEST(frcHelpPolicy, latency)
+{
+    churn(HelpPolicyType::latency);
+}
+
+/**
+ * Helps every baseHelpInterval decrements, more often as the log backs up, and
+ * leaves a short log to the background collectors.
+ */
+TEST(frcHelpPolicy, log_size_cadence)
+{
+    frc::detail::LogSizeHelpPolicy policy;
+
+    EXPECT_TRUE(policy.beginHelp(makeStatus(0, false)) == HelpAction::tryHelp);
+    EXPECT_TRUE(policy.beginHelp(makeStatus(0, true)) == HelpAction::none);
+    EXPECT_EQ(policy.endHelp(0), sz(FRCConstants::baseHelpInterval));
+
+    EXPECT_TRUE(policy.beginHelp(makeStatus(backedUpLogSize, true)) == HelpAction::tryHelp);
+    EXPECT_EQ(policy.endHelp(backedUpLogSize), FRCConstants::baseHelpInterval / 4);
+}
+
+/**
+ * Sizes the recent entries, then helps as LogSizeHelpPolicy below the target
+ * bytes in flight, more often past it, and blocks far past it.
+ */
+TEST(frcHelpPolicy, bytes_in_flight_cadence)
+{
+    FRCToken token;
+    {
+        PrivatePointer<Bulky> objects[FRCConstants::numHelpSizeSamples];
+        ObjectHeader* recent[FRCConstants::numHelpSizeSamples];
+        for(sz i = 0; i < FRCConstants::numHelpSizeSamples; ++i)
+        {
+            objects[i].make();
+            recent[i] = frc::detail::getObjectHeader(objects[i].get());
+        }
+        auto entryBytes = recent[0]->getAllocationSize();
+        auto targetLogSize = FRCConstants::helpTargetBytesInFlight / entryBytes;
+
+        frc::detail::BytesInFlightHelpPolicy policy;
+
+        auto status = makeStatus(targetLogSize / 4, true, recent, FRCConstants::numHelpSizeSamples);
+        EXPECT_TRUE(policy.beginHelp(status) == HelpAction::none);
+        EXPECT_EQ(policy.getAverageEntryBytes(), (float) entryBytes);
+        EXPECT_EQ(policy.endHelp(status.logUsed), sz(FRCConstants::baseHelpInterval));
+
+        status.logUsed = 2 * targetLogSize;
+        EXPECT_TRUE(policy.beginHelp(status) == HelpAction::tryHelp);
+        EXPECT_LT(policy.endHelp(status.logUsed), sz(FRCConstants::baseHelpInterval));
+
+        status.logUsed = 16 * targetLogSize;
+        EXPECT_TRUE(policy.beginHelp(status) == HelpAction::help);
+    }
+
+    //a backed-up log of small entries still shortens the interval
+    frc::detail::BytesInFlightHelpPolicy policy;
+    EXPECT_EQ(policy.endHelp(backedUpLogSize), FRCConstants::baseHelpInterval / 4);
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
+
+/**
+ * Stretches the help interval as help calls get slower, up to maxHelpInterval,
+ * until the log backs up.
+ */
+TEST(frcHelpPolicy, latency_cadence)
+{
+    frc::detail::LatencyHelpPolicy policy;
+
+    EXPECT_TRUE(policy.beginHelp(makeStatus(0, true)) == HelpAction::none);
+    EXPECT_EQ(policy.endHelp(0), sz(FRCConstants::baseHelpInterval));
+
+    //a help call of 100us is over 2000 decrements' worth of budget
+    EXPECT_TRUE(policy.beginHelp(makeStatus(0, false)) == HelpAction::tryHelp);
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    EXPECT_EQ(policy.endHelp(0), sz(FRCConstants::maxHelpInterval));
+
+    EXPECT_EQ(policy.endHelp(backedUpLogSize), FRCConstants::baseHelpInterval / 4);
+}
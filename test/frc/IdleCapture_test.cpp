@@ -0,0 +1,108 @@
+/*
+ * File: IdleCapture_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+struct Tracked : Live
+{
+    lng value;
+};
+
+} /* namespace */
+
+/**
+ * Threads that log fewer decrements than a help interval and then block stay
+ * registered without ever publishing their logs. Helping from one awake
+ * thread still reclaims their garbage, once they have been idle for
+ * idleCaptureTicks.
+ */
+TEST(frcIdleCapture, sleeping_threads)
+{
+    static constexpr sz numSleepers = 15;
+    static constexpr sz numObjects = 8; //per sleeper, fewer than baseHelpInterval decrements
+
+    FRCToken token;
+    std::mutex mutex;
+    std::condition_variable cv;
+    sz numParked = 0;
+    bool wake = false;
+
+    std::vector<std::thread> sleepers;
+    for(sz t = 0; t < numSleepers; ++t)
+    {
+        sleepers.emplace_back([&]()
+        {
+            FRCToken tkn;
+            {
+                AtomicPointer<Tracked> slot;
+                for(sz i = 0; i < numObjects; ++i)
+                    slot.make();
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            ++numParked;
+            cv.notify_all();
+            cv.wait(lock, [&]()
+            {
+                return wake;
+            });
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]()
+        {
+            return numParked == numSleepers;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto timeout = start + std::chrono::seconds(10);
+    while(numLive.load(oacq) != 0 && std::chrono::steady_clock::now() < timeout)
+        frc::detail::getFRCManager().help();
+    auto delay = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(numLive.load(oacq), 0);
+    RecordProperty("reclamation_delay_us",
+                   (int) std::chrono::duration_cast<std::chrono::microseconds>(delay).count());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake = true;
+    }
+    cv.notify_all();
+    for(auto& sleeper : sleepers)
+        sleeper.join();
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
@@ -0,0 +1,39 @@
+/*
+ * File: LiveCount.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "LiveCount.h"
+
+#include <frc/frc.h>
+
+namespace terrain
+{
+namespace frc
+{
+namespace test
+{
+
+atm<lng> numLive(0);
+
+void collectAll()
+{
+    for(sz i = 0; i < 256 && numLive.load(oacq) != 0; ++i)
+    {
+        FRCToken token;
+        detail::FRCManager::collect();
+    }
+}
+
+} /* namespace test */
+} /* namespace frc */
+} /* namespace terrain */
@@ -0,0 +1,59 @@
+/*
+ * File: LiveCount.h
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <util/util.h>
+
+namespace terrain
+{
+namespace frc
+{
+namespace test
+{
+
+//test objects alive, across all tests: each test reclaims its own before it ends
+extern atm<lng> numLive;
+
+/**
+ * Base of the objects the tests make, so that they can check that FRC
+ * destroys every one exactly once.
+ */
+struct Live
+{
+    Live() noexcept
+    {
+        numLive.fetch_add(1, oarl);
+    }
+
+    Live(Live const&) noexcept
+    {
+        numLive.fetch_add(1, oarl);
+    }
+
+    ~Live()
+    {
+        numLive.fetch_sub(1, oarl);
+    }
+};
+
+/**
+ * A single collect() only drains what the helpers reach in one pass, so keep
+ * collecting (boundedly) until everything made by the test is gone.
+ */
+void collectAll();
+
+} /* namespace test */
+} /* namespace frc */
+} /* namespace terrain */
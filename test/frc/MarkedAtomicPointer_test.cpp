@@ -0,0 +1,82 @@
+/*
+ * File: MarkedAtomicPointer_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+struct Item : Live
+{
+    lng value;
+
+    explicit Item(lng value) : value(value)
+    {
+    }
+};
+
+} /* namespace */
+
+/**
+ * Marks must survive compare-exchange, be invisible to pins and dereferences,
+ * and never disturb the target's count.
+ */
+TEST(frcMarkedAtomicPointer, marks)
+{
+    {
+        FRCToken token;
+        MarkedAtomicPointer<Item> edge;
+        edge.make(1);
+
+        PrivatePointer<Item> pinned;
+        ASSERT_EQ(edge.load(pinned), 0u);
+        ASSERT_EQ(pinned->value, 1);
+
+        uintptr_t mark = 0;
+        ASSERT_TRUE(edge.compare_exchange_mark(pinned.get(), mark, 1));
+        ASSERT_TRUE(edge.isMarked());
+        ASSERT_EQ(edge.get(), pinned.get());
+        ASSERT_EQ(edge->value, 1);
+        ASSERT_EQ(pinned.use_count(), 1u);
+
+        //a stale mark must make both forms of compare-exchange fail and report the mark
+        mark = 0;
+        ASSERT_FALSE(edge.compare_exchange_mark(pinned.get(), mark, 1));
+        ASSERT_EQ(mark, 1u);
+
+        PrivatePointer<Item> replacement(2);
+        mark = 0;
+        ASSERT_FALSE(edge.compare_exchange_strong(pinned, mark, replacement, 0));
+        ASSERT_EQ(mark, 1u);
+        ASSERT_EQ(pinned->value, 1);
+
+        ASSERT_TRUE(edge.compare_exchange_strong(pinned, mark, replacement, 0));
+        ASSERT_FALSE(edge.isMarked());
+
+        PrivatePointer<Item> current(edge);
+        ASSERT_EQ(current->value, 2);
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
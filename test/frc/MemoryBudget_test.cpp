@@ -0,0 +1,108 @@
+/*
+ * File: MemoryBudget_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <thread>
+#include <vector>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+struct Block : Live
+{
+    byte bytes[4096];
+};
+
+} /* namespace */
+
+/**
+ * Allocations are counted with their headers, and reclaiming them uncounts them.
+ */
+TEST(frcMemoryBudget, counts_heap_bytes)
+{
+    static constexpr sz numBlocks = 256;
+
+    FRCToken token;
+    for(sz i = 0; i < 4; ++i)
+        frc::detail::FRCManager::collect(); //settle garbage left by earlier tests
+    frc::detail::MemoryBudget::flush();
+    auto before = getHeapBytes();
+
+    {
+        std::vector<AtomicPointer<Block>> blocks(numBlocks);
+        for(auto& block : blocks)
+            block.make();
+
+        frc::detail::MemoryBudget::flush();
+        ASSERT_EQ(getHeapBytes() - before, numBlocks * (sizeof(Block) + sizeof(frc::detail::ObjectHeader)));
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+    frc::detail::MemoryBudget::flush();
+    ASSERT_EQ(getHeapBytes(), before);
+}
+
+/**
+ * Garbage produced faster than a single help call reclaims it drives the heap
+ * past both limits; the callback hears each change of pressure, and
+ * everything is still reclaimed.
+ */
+TEST(frcMemoryBudget, reports_pressure)
+{
+    static constexpr lng numIters = 20000;
+    sz numThreads = std::max(sz(4), (sz) hardwareConcurrency());
+
+    atm<lng> numSoft(0);
+    atm<lng> numHard(0);
+    auto baseline = getHeapBytes();
+    setMemoryBudget(baseline + (sz(1) << 20), baseline + (sz(1) << 21), [&](MemoryPressure pressure, sz)
+    {
+        if(pressure == MemoryPressure::soft)
+            numSoft.fetch_add(1, orlx);
+        else if(pressure == MemoryPressure::hard)
+            numHard.fetch_add(1, orlx);
+    });
+
+    {
+        std::vector<std::thread> threads;
+        for(sz t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                FRCToken tkn;
+                AtomicPointer<Block> slot;
+                for(lng i = 0; i < numIters; ++i)
+                    slot.make();
+            });
+        }
+
+        for(auto& thread : threads)
+            thread.join();
+    }
+
+    collectAll();
+    setMemoryBudget(0, 0);
+    ASSERT_EQ(numLive.load(oacq), 0);
+    ASSERT_GT(numSoft.load(orlx) + numHard.load(orlx), 0);
+}
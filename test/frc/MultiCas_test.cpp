@@ -0,0 +1,108 @@
+/*
+ * File: MultiCas_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <thread>
+#include <vector>
+
+#include <frc/frc.h>
+#include <util/FastRNG.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+struct Balance : Live
+{
+    lng value;
+
+    explicit Balance(lng value) : value(value)
+    {
+    }
+};
+
+} /* namespace */
+
+/**
+ * Threads move units between random accounts, each move replacing two or three
+ * balances with one MultiCas. Totals must be conserved, and every replaced
+ * balance and descriptor reclaimed.
+ */
+TEST(frcMultiCas, transfers)
+{
+    static constexpr sz numAccounts = 16;
+    static constexpr lng initialBalance = 1000;
+    static constexpr lng numTransfers = 20000;
+    sz numThreads = std::max(sz(4), (sz) hardwareConcurrency());
+
+    {
+        FRCToken token;
+        std::unique_ptr<CasPointer<Balance>[]> accounts(new CasPointer<Balance>[numAccounts]);
+        for(sz i = 0; i < numAccounts; ++i)
+            accounts[i].make(initialBalance);
+
+        std::vector<std::thread> threads;
+        for(sz t = 0; t < numThreads; ++t)
+        {
+            threads.emplace_back([&]()
+            {
+                FRCToken tkn;
+                lng committed = 0;
+                while(committed < numTransfers)
+                {
+                    sz from = FastRNG::next(numAccounts);
+                    sz to = FastRNG::next(numAccounts);
+                    sz fee = FastRNG::next(numAccounts);
+                    if(from == to)
+                        continue;
+
+                    bool threeWay = fee != from && fee != to; //half the amount goes to a third account
+                    PrivatePointer<Balance> oldFrom, oldTo, oldFee;
+                    accounts[from].load(oldFrom);
+                    accounts[to].load(oldTo);
+                    PrivatePointer<Balance> newFrom(oldFrom->value - 2);
+                    PrivatePointer<Balance> newTo(oldTo->value + (threeWay ? 1 : 2));
+                    PrivatePointer<Balance> newFee;
+
+                    MultiCas cas;
+                    cas.add(accounts[from], oldFrom, newFrom).add(accounts[to], oldTo, newTo);
+                    if(threeWay)
+                    {
+                        accounts[fee].load(oldFee);
+                        newFee.make(oldFee->value + 1);
+                        cas.add(accounts[fee], oldFee, newFee);
+                    }
+                    committed += cas.execute();
+                }
+            });
+        }
+
+        for(auto& thread : threads)
+            thread.join();
+
+        lng total = 0;
+        for(sz i = 0; i < numAccounts; ++i)
+            total += accounts[i].get()->value;
+        ASSERT_EQ(total, (lng)(numAccounts * initialBalance));
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
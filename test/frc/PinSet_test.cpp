@@ -0,0 +1,174 @@
+/*
+ * File: PinSet_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <thread>
+#include <vector>
+
+#include <frc/frc.h>
+#include <util/FastRNG.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+static constexpr lng alive = 0x5ca1ab1e;
+
+struct Canary : Live
+{
+    atm<lng> state;
+
+    Canary()
+    {
+        state.store(alive, orls);
+    }
+
+    ~Canary()
+    {
+        state.store(0, orls);
+    }
+};
+
+} /* namespace */
+
+/**
+ * Readers pin the targets of slots that writers keep replacing, while the
+ * writers' decrements drive collection. A pinned target must never be
+ * destroyed, whichever way it was pinned.
+ */
+TEST(frcPinSet, publish_stress)
+{
+    static constexpr sz numSlots = 8;
+    static constexpr lng numReads = 200000;
+    sz numThreads = std::max(sz(4), (sz) hardwareConcurrency());
+
+    {
+        FRCToken token;
+        std::unique_ptr<AtomicPointer<Canary>[]> slots(new AtomicPointer<Canary>[numSlots]);
+        std::unique_ptr<MarkedAtomicPointer<Canary>[]> markedSlots(new MarkedAtomicPointer<Canary>[numSlots]);
+        for(sz i = 0; i < numSlots; ++i)
+        {
+            slots[i].make();
+            markedSlots[i].make();
+        }
+
+        atm<sz> numReaders(numThreads / 2);
+        std::vector<std::thread> threads;
+        for(sz t = 0; t < numThreads; ++t)
+        {
+            bool reader = t < numThreads / 2;
+            threads.emplace_back([&, reader]()
+            {
+                FRCToken tkn;
+                if(!reader)
+                {
+                    while(numReaders.load(oacq) != 0)
+                    {
+                        slots[FastRNG::next(numSlots)].make();
+                        markedSlots[FastRNG::next(numSlots)].make();
+                    }
+                    return;
+                }
+
+                PrivatePointer<Canary> pinned;
+                PrivatePointer<Canary> marked;
+                for(lng i = 0; i < numReads; ++i)
+                {
+                    pinned = slots[FastRNG::next(numSlots)];
+                    markedSlots[FastRNG::next(numSlots)].load(marked);
+                    if(i % 64 == 0)
+                        std::this_thread::yield(); //let writers and collection run while pinned
+
+                    ASSERT_EQ(pinned->state.load(oacq), alive);
+                    ASSERT_EQ(marked->state.load(oacq), alive);
+                }
+                numReaders.fetch_sub(1, orls);
+            });
+        }
+
+        for(auto& thread : threads)
+            thread.join();
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
+
+/**
+ * A thread can hold far more pins than fit in one block, and every block is
+ * scanned: objects reachable only through pins survive collection.
+ */
+TEST(frcPinSet, many_pins)
+{
+    static constexpr sz numPins = 100000;
+
+    {
+        FRCToken token;
+        atm<bool> pinned(false);
+        atm<bool> collected(false);
+
+        std::thread pinner([&]()
+        {
+            FRCToken tkn;
+            std::vector<PrivatePointer<Canary>> pins;
+            pins.reserve(numPins);
+
+            AtomicPointer<Canary> slot;
+            for(sz i = 0; i < numPins; ++i)
+            {
+                slot.make();
+                pins.emplace_back(slot);
+            }
+
+            //unpinned garbage, logged after the pinned objects' decrements
+            for(sz i = 0; i < numPins; ++i)
+                slot.make();
+            slot = nullptr;
+            pinned.store(true, orls);
+
+            while(!collected.load(oacq))
+                std::this_thread::yield();
+
+            for(auto& pin : pins)
+                ASSERT_EQ(pin->state.load(oacq), alive);
+        });
+
+        while(!pinned.load(oacq))
+            std::this_thread::yield();
+
+        /* collect() would wait on the decrements that keep re-protecting the
+         * pins, so help instead until the garbage is reclaimed, short of the
+         * pinner's last unpublished log block.
+         */
+        static constexpr lng numUnpublished = frc::detail::FRCConstants::logBlockSize;
+        for(sz i = 0; i < 1024 * 1024 && numLive.load(oacq) > (lng) numPins + numUnpublished; ++i)
+            frc::detail::getFRCManager().help();
+        for(sz i = 0; i < 1024; ++i)
+            frc::detail::getFRCManager().help();
+        ASSERT_LE(numLive.load(oacq), (lng) numPins + numUnpublished);
+        ASSERT_GE(numLive.load(oacq), (lng) numPins);
+        collected.store(true, orls);
+
+        pinner.join();
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
@@ -0,0 +1,97 @@
+/*
+ * File: PrivatePointer_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+struct Counter : Live
+{
+    lng value;
+
+    explicit Counter(lng value) : value(value)
+    {
+    }
+};
+
+} /* namespace */
+
+/**
+ * An object that was made and never shared is destroyed as soon as its
+ * PrivatePointer lets go of it, without a collection.
+ */
+TEST(frcPrivatePointer, unshared_release)
+{
+    FRCToken token;
+    {
+        PrivatePointer<Counter> made(1);
+        ASSERT_EQ(numLive.load(oacq), 1);
+        ASSERT_EQ(made->value, 1);
+
+        made.make(2);
+        ASSERT_EQ(numLive.load(oacq), 1);
+        ASSERT_EQ(made->value, 2);
+
+        PrivatePointer<Counter> moved(std::move(made));
+        ASSERT_EQ(numLive.load(oacq), 1);
+
+        moved = nullptr;
+        ASSERT_EQ(numLive.load(oacq), 0);
+
+        PrivatePointer<Counter> dropped(3);
+    }
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
+
+/**
+ * Once an object has been copied or published it is left to the collector,
+ * however it was shared.
+ */
+TEST(frcPrivatePointer, shared_release)
+{
+    {
+        FRCToken token;
+        AtomicPointer<Counter> shared;
+        {
+            PrivatePointer<Counter> made(1);
+            shared = made;
+        }
+        ASSERT_EQ(shared->value, 1);
+
+        PrivatePointer<Counter> copy;
+        {
+            PrivatePointer<Counter> made(2);
+            copy = made;
+        }
+        ASSERT_EQ(copy->value, 2);
+
+        PrivatePointer<Counter> self(3);
+        self = self;
+        ASSERT_EQ(self->value, 3);
+        ASSERT_EQ(numLive.load(oacq), 3);
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
@@ -0,0 +1,84 @@
+/*
+ * File: ReadSection_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <chrono>
+#include <thread>
+
+#include <frc/frc.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+struct Counter : Live
+{
+    lng value;
+
+    explicit Counter(lng value) : value(value)
+    {
+    }
+};
+
+} /* namespace */
+
+/**
+ * An object read through a raw pointer inside a read section outlives its
+ * last reference until the section ends, even while another thread collects.
+ */
+TEST(frcReadSection, protects_raw_reads)
+{
+    {
+        FRCToken token;
+        AtomicPointer<Counter> shared(1);
+        atm<bool> entered(false);
+        atm<bool> replaced(false);
+
+        std::thread reader([&]()
+        {
+            FRCToken tkn;
+            ReadSection section;
+            Counter* counter = shared.get();
+            entered.store(true, orls);
+
+            {
+                ReadSection nested;
+            }
+
+            while(!replaced.load(oacq))
+                std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50)); //let the collector try
+
+            ASSERT_EQ(counter->value, 1);
+            ASSERT_EQ(numLive.load(oacq), 2);
+        });
+
+        while(!entered.load(oacq))
+            std::this_thread::yield();
+        shared.make(2);
+        replaced.store(true, orls);
+        frc::detail::FRCManager::collect(); //publishes the decrement, then waits for the reader
+
+        reader.join();
+    }
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}
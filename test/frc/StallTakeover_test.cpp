@@ -0,0 +1,145 @@
+/*
+ * File: StallTakeover_test.cpp
+ * Copyright 2018 Terrain Data, Inc.
+ *
+ * This file is part of FRC, a fast reference counting library for C++
+ * (see <https://github.com/terraindata/frc>).
+ *
+ * FRC is distributed under the MIT License, which is found in
+ * COPYING.md in the repository.
+ *
+ * You should have received a copy of the MIT License
+ * along with FRC.  If not, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+#include <precompiled.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <frc/frc.h>
+#include <util/tls.h>
+
+#include "LiveCount.h"
+
+using namespace terrain;
+using namespace terrain::frc;
+using namespace terrain::frc::test;
+
+namespace
+{
+
+static constexpr lng alive = 0x5ca1ab1e;
+
+struct Canary : Live
+{
+    atm<lng> state;
+
+    Canary()
+    {
+        state.store(alive, orls);
+    }
+
+    ~Canary()
+    {
+        EXPECT_EQ(state.load(oacq), alive); //destroyed once
+        state.store(0, orls);
+    }
+};
+
+std::mutex mutex;
+std::condition_variable cv;
+bool parked = false;
+bool released = false;
+
+tls(bool, isStalling);
+
+/**
+ * Stands in for the stalling thread being descheduled as soon as it has
+ * claimed entries of a sweep block, before it takes any of them.
+ */
+void park()
+{
+    if(!isStalling)
+        return;
+    isStalling = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    parked = true;
+    cv.notify_all();
+    cv.wait(lock, []()
+    {
+        return released;
+    });
+}
+
+} /* namespace */
+
+/**
+ * A helper parks holding a claimed chunk of a sweep block. Without a
+ * takeover, no step can end until it wakes; other helpers must take over the
+ * block, and keep reclaiming everything but that chunk while it is parked,
+ * reusing log segments as they go. Once it wakes, it must apply the chunk
+ * from the log as it was: each object is destroyed exactly once.
+ */
+TEST(frcStallTakeover, parked_sweeper)
+{
+    static constexpr sz numObjects = 4096;
+    static constexpr sz numClaimed = frc::detail::FRCConstants::logBlockSize; //at most, by the parked helper
+    if(frc::detail::FRCConstants::taskStallTicks == 0)
+        return;
+
+    FRCToken token;
+    auto makeGarbage = []()
+    {
+        AtomicPointer<Canary> slot;
+        for(sz i = 0; i < numObjects; ++i)
+            slot.make();
+    };
+
+    makeGarbage();
+    frc::detail::ThreadData::sweepClaimedHook.store(&park, orls);
+
+    std::thread stalling([&]()
+    {
+        FRCToken tkn;
+        isStalling = true;
+        auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while(isStalling && std::chrono::steady_clock::now() < timeout)
+            frc::detail::getFRCManager().help();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(10), []()
+        {
+            return parked;
+        });
+    }
+    EXPECT_TRUE(parked);
+
+    if(parked)
+    {
+        //reclaimed only if steps go on past the parked block
+        for(sz i = 0; i < 4; ++i)
+            makeGarbage();
+
+        auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while(numLive.load(oacq) > (lng) numClaimed && std::chrono::steady_clock::now() < timeout)
+            frc::detail::getFRCManager().help();
+        EXPECT_LE(numLive.load(oacq), (lng) numClaimed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+    }
+    cv.notify_all();
+    stalling.join();
+    frc::detail::ThreadData::sweepClaimedHook.store(nullptr, orls);
+
+    collectAll();
+    ASSERT_EQ(numLive.load(oacq), 0);
+}